@@ -0,0 +1,785 @@
+# pragma once
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+#include "skiplist.h"
+
+namespace kvstore {
+
+/**
+ * Where the primary listens and the follower connects: either a unix domain
+ * socket path or a tcp port on the loopback interface.
+ */
+struct Endpoint {
+    enum class Kind { Unix, Tcp };
+
+    static auto Unix(std::string path) -> Endpoint {
+        return {Kind::Unix, std::move(path), 0};
+    }
+
+    static auto Tcp(uint16_t port) -> Endpoint {
+        return {Kind::Tcp, {}, port};
+    }
+
+    Kind kind;
+    std::string path;
+    uint16_t port;
+};
+
+struct ReplicationOptions {
+    size_t log_capacity {1 << 20};  // mutations retained for catch-up, older ones need a snapshot
+    size_t max_batch {512};         // mutations shipped per batch frame
+    size_t max_inflight {8};        // unacknowledged frames before the shipper waits
+    size_t snapshot_chunk {4096};   // entries per snapshot chunk frame
+};
+
+/**
+ * One record of the primary's mutation log.
+ */
+template <typename K, typename V>
+struct LogEntry {
+    uint64_t seq;
+    LogOp op;
+    K key;
+    V value;
+    K end;  // exclusive upper bound of a RemoveRange tombstone
+};
+
+namespace replication {
+
+enum class FrameType : uint32_t {
+    Hello,          // follower -> primary, seq = last applied sequence, epoch = log it came from
+    Batch,          // primary -> follower, `count` LogEntry records
+    SnapshotBegin,  // primary -> follower, seq = log position the copy started at
+    SnapshotChunk,  // primary -> follower, `count` SnapshotRecord records
+    SnapshotLog,    // primary -> follower, `count` LogEntry records logged while the chunks were copied
+    SnapshotEnd,    // primary -> follower, the snapshot is complete up to seq
+    Ack,            // follower -> primary, everything up to seq is applied
+};
+
+struct FrameHeader {
+    FrameType type;
+    uint32_t count;
+    uint64_t seq;
+    uint64_t stamp_ns;  // primary send time, echoed back by the ack
+    uint64_t epoch;     // incarnation of the primary's log, 0 from a follower that applied nothing
+};
+
+template <typename K, typename V>
+struct SnapshotRecord {
+    K key;
+    V value;
+};
+
+inline auto NowNanos() -> uint64_t {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline auto WriteAll(int fd, const void *buf, size_t len) -> bool {
+    auto p = static_cast<const char *>(buf);
+    while (len > 0) {
+        auto n = ::send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+inline auto ReadAll(int fd, void *buf, size_t len) -> bool {
+    auto p = static_cast<char *>(buf);
+    while (len > 0) {
+        auto n = ::recv(fd, p, len, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+/**
+ * @brief send the header and its payload with a single syscall.
+ */
+inline auto WriteFrame(int fd, const FrameHeader &hdr, const void *payload, size_t len) -> bool {
+    iovec iov[2] = {{const_cast<FrameHeader *>(&hdr), sizeof(hdr)},
+                    {const_cast<void *>(payload), len}};
+    msghdr msg{};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = len > 0 ? 2 : 1;
+    auto n = ::sendmsg(fd, &msg, MSG_NOSIGNAL);
+    while (n < 0 && errno == EINTR) {
+        n = ::sendmsg(fd, &msg, MSG_NOSIGNAL);
+    }
+    if (n < 0) {
+        return false;
+    }
+    // short write: push out whatever is left
+    auto sent = static_cast<size_t>(n);
+    if (sent < sizeof(hdr)) {
+        return WriteAll(fd, reinterpret_cast<const char *>(&hdr) + sent, sizeof(hdr) - sent) &&
+               WriteAll(fd, payload, len);
+    }
+    sent -= sizeof(hdr);
+    return WriteAll(fd, static_cast<const char *>(payload) + sent, len - sent);
+}
+
+inline auto MakeAddress(const Endpoint &ep, sockaddr_storage &storage, socklen_t &len) -> bool {
+    std::memset(&storage, 0, sizeof(storage));
+    if (ep.kind == Endpoint::Kind::Unix) {
+        auto addr = reinterpret_cast<sockaddr_un *>(&storage);
+        if (ep.path.size() >= sizeof(addr->sun_path)) {
+            return false;
+        }
+        addr->sun_family = AF_UNIX;
+        std::memcpy(addr->sun_path, ep.path.c_str(), ep.path.size() + 1);
+        len = sizeof(sockaddr_un);
+    } else {
+        auto addr = reinterpret_cast<sockaddr_in *>(&storage);
+        addr->sin_family = AF_INET;
+        addr->sin_port = htons(ep.port);
+        addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        len = sizeof(sockaddr_in);
+    }
+    return true;
+}
+
+inline void TuneSocket(int fd, const Endpoint &ep) {
+    if (ep.kind == Endpoint::Kind::Tcp) {
+        int yes = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+    }
+}
+
+/**
+ * @return a listening socket, or -1 on failure
+ */
+inline auto Listen(const Endpoint &ep) -> int {
+    sockaddr_storage addr;
+    socklen_t len;
+    if (!MakeAddress(ep, addr, len)) {
+        return -1;
+    }
+    int fd = ::socket(addr.ss_family, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (ep.kind == Endpoint::Kind::Unix) {
+        ::unlink(ep.path.c_str());
+    } else {
+        int yes = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    }
+    if (::bind(fd, reinterpret_cast<sockaddr *>(&addr), len) < 0 || ::listen(fd, 1) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @return a connected socket, or -1 on failure
+ */
+inline auto Connect(const Endpoint &ep) -> int {
+    sockaddr_storage addr;
+    socklen_t len;
+    if (!MakeAddress(ep, addr, len)) {
+        return -1;
+    }
+    int fd = ::socket(addr.ss_family, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), len) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    TuneSocket(fd, ep);
+    return fd;
+}
+
+}  // namespace replication
+
+/**
+ * Bounded in-memory mutation log. Entry `seq` lives in slot `seq % capacity`,
+ * so once the log wraps the oldest mutations are gone and a follower that
+ * still needs them has to be reseeded from a snapshot.
+ */
+template <typename K, typename V>
+class MutationLog {
+public:
+    explicit MutationLog(size_t capacity) : ring_(capacity), epoch_(NewEpoch()) {}
+
+    /**
+     * @brief random id of this log, sequence numbers from another
+     *        incarnation (e.g. before a primary restart) mean nothing here
+     */
+    auto Epoch() const -> uint64_t {
+        return epoch_;
+    }
+
+    void Append(LogOp op, const K &key, const V &value, const K &end) {
+        {
+            std::lock_guard<std::mutex> lk{mutex_};
+            last_seq_ += 1;
+            ring_[last_seq_ % ring_.size()] = {last_seq_, op, key, value, end};
+        }
+        cond_.notify_one();
+    }
+
+    auto LastSeq() -> uint64_t {
+        std::lock_guard<std::mutex> lk{mutex_};
+        return last_seq_;
+    }
+
+    /**
+     * @brief copy up to `max` entries following `from` into `out`
+     * @return false if the entry right after `from` was already overwritten
+     */
+    auto ReadAfter(uint64_t from, size_t max, std::vector<LogEntry<K, V>> &out) -> bool {
+        std::lock_guard<std::mutex> lk{mutex_};
+        out.clear();
+        uint64_t oldest = last_seq_ >= ring_.size() ? last_seq_ - ring_.size() + 1 : 1;
+        if (from + 1 < oldest) {
+            return false;
+        }
+        for (auto seq = from + 1; seq <= last_seq_ && out.size() < max; ++seq) {
+            out.push_back(ring_[seq % ring_.size()]);
+        }
+        return true;
+    }
+
+    /**
+     * @brief block until something after `from` is appended or `timeout` passes
+     */
+    auto WaitAfter(uint64_t from, std::chrono::milliseconds timeout) -> bool {
+        std::unique_lock<std::mutex> lk{mutex_};
+        return cond_.wait_for(lk, timeout, [&] { return last_seq_ > from; });
+    }
+
+private:
+    static auto NewEpoch() -> uint64_t {
+        std::random_device rd;
+        auto epoch = (uint64_t{rd()} << 32 | rd()) ^
+                     static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
+        return epoch != 0 ? epoch : 1;
+    }
+
+    std::vector<LogEntry<K, V>> ring_;
+    const uint64_t epoch_;
+    uint64_t last_seq_ {0};
+    std::mutex mutex_;
+    std::condition_variable cond_;
+};
+
+/**
+ * The primary side of log shipping. It records every mutation of `list` in a
+ * MutationLog and streams it in batches to at most one follower at a time.
+ * Mutations go straight to the list as before; shipping happens on a
+ * background thread. A snapshot for a follower that fell behind is copied
+ * `snapshot_chunk` entries per hold of the list mutex, so writers wait at
+ * most for one chunk, never for the whole list.
+ */
+template <typename K, typename V>
+class ReplicationPrimary {
+    static_assert(std::is_trivially_copyable_v<K> && std::is_trivially_copyable_v<V>,
+                  "log entries are shipped as raw bytes");
+    using FrameHeader = replication::FrameHeader;
+    using FrameType = replication::FrameType;
+
+public:
+    explicit ReplicationPrimary(SkipList<K, V> &list, ReplicationOptions options = {})
+        : list_(list), options_(options), log_(options.log_capacity) {
+        list_.SetMutationListener([this](LogOp op, const K &key, const V &value, const K &end) {
+            log_.Append(op, key, value, end);
+        });
+    }
+
+    ~ReplicationPrimary() {
+        Stop();
+        list_.SetMutationListener(nullptr);
+    }
+
+    ReplicationPrimary(const ReplicationPrimary &) = delete;
+    ReplicationPrimary &operator=(const ReplicationPrimary &) = delete;
+
+    /**
+     * @brief start accepting followers on `ep`
+     */
+    auto Serve(const Endpoint &ep) -> bool {
+        endpoint_ = ep;
+        listen_fd_ = replication::Listen(ep);
+        if (listen_fd_ < 0) {
+            return false;
+        }
+        running_ = true;
+        server_ = std::thread([this] { AcceptLoop(); });
+        return true;
+    }
+
+    void Stop() {
+        if (!running_.exchange(false)) {
+            return;
+        }
+        ::shutdown(listen_fd_, SHUT_RDWR);
+        {
+            std::lock_guard<std::mutex> lk{window_mutex_};
+            if (conn_fd_ >= 0) {
+                ::shutdown(conn_fd_, SHUT_RDWR);
+            }
+        }
+        window_cond_.notify_all();
+        server_.join();
+        ::close(listen_fd_);
+        if (endpoint_.kind == Endpoint::Kind::Unix) {
+            ::unlink(endpoint_.path.c_str());
+        }
+    }
+
+    auto LastSeq() -> uint64_t {
+        return log_.LastSeq();
+    }
+
+    auto AckedSeq() const -> uint64_t {
+        return acked_seq_.load();
+    }
+
+    /**
+     * @brief number of mutations not yet acknowledged by the follower
+     */
+    auto Lag() -> uint64_t {
+        auto last = LastSeq();
+        auto acked = AckedSeq();
+        return last > acked ? last - acked : 0;
+    }
+
+    /**
+     * @brief time from shipping the most recently acknowledged frame until
+     *        the follower reported it applied
+     */
+    auto LastAckLatency() const -> std::chrono::nanoseconds {
+        return std::chrono::nanoseconds(last_ack_latency_ns_.load());
+    }
+
+    auto SnapshotsSent() const -> uint64_t {
+        return snapshots_sent_.load();
+    }
+
+    auto HasFollower() const -> bool {
+        return has_follower_.load();
+    }
+
+private:
+    void AcceptLoop() {
+        while (running_) {
+            int fd = ::accept(listen_fd_, nullptr, nullptr);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) {
+                    continue;
+                }
+                break;
+            }
+            replication::TuneSocket(fd, endpoint_);
+            {
+                std::lock_guard<std::mutex> lk{window_mutex_};
+                conn_fd_ = fd;
+                inflight_ = 0;
+            }
+            if (!running_) {
+                // Stop() may have run before conn_fd_ was published
+                ::close(fd);
+                break;
+            }
+            Session(fd);
+            {
+                std::lock_guard<std::mutex> lk{window_mutex_};
+                conn_fd_ = -1;
+            }
+            ::close(fd);
+        }
+    }
+
+    void Session(int fd) {
+        FrameHeader hello;
+        if (!replication::ReadAll(fd, &hello, sizeof(hello)) || hello.type != FrameType::Hello) {
+            return;
+        }
+        acked_seq_ = hello.seq;
+        has_follower_ = true;
+
+        std::atomic<bool> alive {true};
+        std::thread acker([&] {
+            FrameHeader ack;
+            while (replication::ReadAll(fd, &ack, sizeof(ack)) && ack.type == FrameType::Ack) {
+                acked_seq_ = ack.seq;
+                last_ack_latency_ns_ = replication::NowNanos() - ack.stamp_ns;
+                {
+                    std::lock_guard<std::mutex> lk{window_mutex_};
+                    inflight_ -= 1;
+                }
+                window_cond_.notify_one();
+            }
+            {
+                std::lock_guard<std::mutex> lk{window_mutex_};
+                alive = false;
+            }
+            window_cond_.notify_one();
+        });
+
+        Ship(fd, hello.seq, hello.epoch, alive);
+        ::shutdown(fd, SHUT_RDWR);
+        acker.join();
+        has_follower_ = false;
+    }
+
+    void Ship(int fd, uint64_t sent, uint64_t epoch, const std::atomic<bool> &alive) {
+        std::vector<LogEntry<K, V>> batch;
+        batch.reserve(options_.max_batch);
+        // a follower that applied another incarnation of this log, or one
+        // ahead of it, has to start over from a snapshot
+        bool fresh = epoch == 0 && sent == 0;
+        bool resync = (!fresh && epoch != log_.Epoch()) || sent > log_.LastSeq();
+        while (running_ && alive) {
+            if (resync || !log_.ReadAfter(sent, options_.max_batch, batch)) {
+                // the follower is further behind than the log reaches
+                if (!SendSnapshot(fd, sent, alive)) {
+                    return;
+                }
+                resync = false;
+                continue;
+            }
+            if (batch.empty()) {
+                log_.WaitAfter(sent, std::chrono::milliseconds(50));
+                continue;
+            }
+            if (!AcquireWindow(alive)) {
+                return;
+            }
+            FrameHeader hdr {FrameType::Batch, static_cast<uint32_t>(batch.size()),
+                             batch.back().seq, replication::NowNanos(), log_.Epoch()};
+            if (!replication::WriteFrame(fd, hdr, batch.data(), batch.size() * sizeof(LogEntry<K, V>))) {
+                return;
+            }
+            sent = batch.back().seq;
+        }
+    }
+
+    /**
+     * @brief copy the list a chunk at a time, then send what was logged
+     *        meanwhile: every logged op overwrites or deletes its keys, so
+     *        replaying them in order on the copied chunks gives the list as
+     *        of the last replayed seq. Starts over if the log wrapped first.
+     */
+    auto SendSnapshot(int fd, uint64_t &sent, const std::atomic<bool> &alive) -> bool {
+        std::vector<replication::SnapshotRecord<K, V>> records;
+        std::vector<LogEntry<K, V>> batch;
+        records.reserve(options_.snapshot_chunk);
+        auto epoch = log_.Epoch();
+        while (running_ && alive) {
+            // mutations are logged under the list mutex, so every mutation
+            // up to here is in the list before the first chunk is copied
+            auto start_seq = log_.LastSeq();
+            FrameHeader begin {FrameType::SnapshotBegin, 0, start_seq, replication::NowNanos(), epoch};
+            if (!replication::WriteFrame(fd, begin, nullptr, 0)) {
+                return false;
+            }
+            const K *after = nullptr;
+            K last {};
+            while (true) {
+                records.clear();
+                list_.ForEachAfter(after, options_.snapshot_chunk,
+                                   [&](const K &key, const V &value) { records.push_back({key, value}); });
+                if (records.empty()) {
+                    break;
+                }
+                FrameHeader chunk {FrameType::SnapshotChunk, static_cast<uint32_t>(records.size()),
+                                   start_seq, 0, epoch};
+                if (!replication::WriteFrame(fd, chunk, records.data(), records.size() * sizeof(records[0]))) {
+                    return false;
+                }
+                last = records.back().key;
+                after = &last;
+            }
+
+            auto end_seq = log_.LastSeq();
+            auto replayed = start_seq;
+            while (replayed < end_seq && log_.ReadAfter(replayed, options_.max_batch, batch)) {
+                while (!batch.empty() && batch.back().seq > end_seq) {
+                    batch.pop_back();
+                }
+                FrameHeader replay {FrameType::SnapshotLog, static_cast<uint32_t>(batch.size()),
+                                    batch.back().seq, 0, epoch};
+                if (!replication::WriteFrame(fd, replay, batch.data(), batch.size() * sizeof(batch[0]))) {
+                    return false;
+                }
+                replayed = batch.back().seq;
+            }
+            if (replayed < end_seq) {
+                // the log wrapped while the chunks were copied
+                continue;
+            }
+
+            if (!AcquireWindow(alive)) {
+                return false;
+            }
+            FrameHeader end {FrameType::SnapshotEnd, 0, end_seq, replication::NowNanos(), epoch};
+            if (!replication::WriteFrame(fd, end, nullptr, 0)) {
+                return false;
+            }
+            sent = end_seq;
+            snapshots_sent_ += 1;
+            return true;
+        }
+        return false;
+    }
+
+    auto AcquireWindow(const std::atomic<bool> &alive) -> bool {
+        std::unique_lock<std::mutex> lk{window_mutex_};
+        window_cond_.wait(lk, [&] {
+            return inflight_ < options_.max_inflight || !alive || !running_;
+        });
+        if (!alive || !running_) {
+            return false;
+        }
+        inflight_ += 1;
+        return true;
+    }
+
+private:
+    SkipList<K, V> &list_;
+    ReplicationOptions options_;
+    MutationLog<K, V> log_;
+    Endpoint endpoint_;
+
+    int listen_fd_ {-1};
+    int conn_fd_ {-1};
+    std::atomic<bool> running_ {false};
+    std::thread server_;
+
+    std::mutex window_mutex_;
+    std::condition_variable window_cond_;
+    size_t inflight_ {0};
+
+    std::atomic<uint64_t> acked_seq_ {0};
+    std::atomic<uint64_t> last_ack_latency_ns_ {0};
+    std::atomic<uint64_t> snapshots_sent_ {0};
+    std::atomic<bool> has_follower_ {false};
+};
+
+/**
+ * The follower side of log shipping: a warm standby that keeps its own
+ * SkipList in sync with a primary and serves reads from it. Each batch is
+ * applied under one exclusive hold of the read/write mutex; a snapshot is
+ * built off to the side and swapped in at once.
+ */
+template <typename K, typename V>
+class ReplicationFollower {
+    static_assert(std::is_trivially_copyable_v<K> && std::is_trivially_copyable_v<V>,
+                  "log entries are shipped as raw bytes");
+    using FrameHeader = replication::FrameHeader;
+    using FrameType = replication::FrameType;
+
+public:
+    explicit ReplicationFollower(int max_height=10)
+        : max_height_(max_height), list_(std::make_unique<SkipList<K, V>>(max_height)) {}
+
+    ~ReplicationFollower() {
+        Stop();
+    }
+
+    ReplicationFollower(const ReplicationFollower &) = delete;
+    ReplicationFollower &operator=(const ReplicationFollower &) = delete;
+
+    /**
+     * @brief connect to the primary and resume from the last applied sequence
+     */
+    auto Connect(const Endpoint &ep) -> bool {
+        Stop();
+        fd_ = replication::Connect(ep);
+        if (fd_ < 0) {
+            return false;
+        }
+        FrameHeader hello {FrameType::Hello, 0, applied_seq_.load(), 0, epoch_};
+        if (!replication::WriteAll(fd_, &hello, sizeof(hello))) {
+            ::close(fd_);
+            fd_ = -1;
+            return false;
+        }
+        connected_ = true;
+        applier_ = std::thread([this] { ApplyLoop(); });
+        return true;
+    }
+
+    void Stop() {
+        if (fd_ < 0) {
+            return;
+        }
+        ::shutdown(fd_, SHUT_RDWR);
+        applier_.join();
+        ::close(fd_);
+        fd_ = -1;
+    }
+
+    /**
+     * @brief false once the primary has gone away
+     */
+    auto Connected() const -> bool {
+        return connected_.load();
+    }
+
+    auto AppliedSeq() const -> uint64_t {
+        return applied_seq_.load();
+    }
+
+    auto Get(K key) -> std::optional<V> {
+        std::shared_lock<std::shared_mutex> lk{list_mutex_};
+        auto node = list_->Search(key);
+        if (node->IsSentinel() || node->Key() != key) {
+            return std::nullopt;
+        }
+        return node->Value();
+    }
+
+    auto Size() -> int {
+        std::shared_lock<std::shared_mutex> lk{list_mutex_};
+        return list_->Size();
+    }
+
+private:
+    void ApplyLoop() {
+        FrameHeader hdr;
+        while (replication::ReadAll(fd_, &hdr, sizeof(hdr)) && HandleFrame(hdr)) {
+        }
+        connected_ = false;
+    }
+
+    /**
+     * @brief read the `count` log entries of a frame, false unless they are
+     *        from log `epoch` and follow right after `seq`
+     */
+    auto ReadEntries(const FrameHeader &hdr, uint64_t epoch, uint64_t seq) -> bool {
+        batch_.resize(hdr.count);
+        return replication::ReadAll(fd_, batch_.data(), hdr.count * sizeof(LogEntry<K, V>)) && hdr.count > 0 &&
+               hdr.epoch == epoch && batch_.front().seq == seq + 1 && batch_.back().seq == hdr.seq;
+    }
+
+    static void Apply(SkipList<K, V> &list, const std::vector<LogEntry<K, V>> &entries) {
+        for (const auto &entry : entries) {
+            switch (entry.op) {
+            case LogOp::Put:
+                list.Insert(entry.key, entry.value);
+                break;
+            case LogOp::Remove:
+                list.Remove(entry.key);
+                break;
+            case LogOp::RemoveRange:
+                list.RemoveRange(entry.key, entry.end);
+                break;
+            }
+        }
+    }
+
+    auto HandleFrame(const FrameHeader &hdr) -> bool {
+        switch (hdr.type) {
+        case FrameType::Batch:
+            // a follower that applied nothing yet joins whichever log it is sent
+            if (!ReadEntries(hdr, epoch_ != 0 ? epoch_ : hdr.epoch, applied_seq_.load())) {
+                return false;
+            }
+            {
+                std::unique_lock<std::shared_mutex> lk{list_mutex_};
+                Apply(*list_, batch_);
+            }
+            epoch_ = hdr.epoch;
+            return Ack(hdr);
+        case FrameType::SnapshotBegin:
+            pending_ = std::make_unique<SkipList<K, V>>(max_height_);
+            pending_seq_ = hdr.seq;
+            pending_epoch_ = hdr.epoch;
+            return true;
+        case FrameType::SnapshotLog:
+            if (pending_ == nullptr || !ReadEntries(hdr, pending_epoch_, pending_seq_)) {
+                return false;
+            }
+            Apply(*pending_, batch_);
+            pending_seq_ = hdr.seq;
+            return true;
+        case FrameType::SnapshotChunk:
+            chunk_.resize(hdr.count);
+            if (pending_ == nullptr || hdr.epoch != pending_epoch_ ||
+                !replication::ReadAll(fd_, chunk_.data(), hdr.count * sizeof(chunk_[0]))) {
+                return false;
+            }
+            for (const auto &record : chunk_) {
+                pending_->Insert(record.key, record.value);
+            }
+            return true;
+        case FrameType::SnapshotEnd:
+            if (pending_ == nullptr || hdr.epoch != pending_epoch_ || hdr.seq != pending_seq_) {
+                return false;
+            }
+            {
+                std::unique_lock<std::shared_mutex> lk{list_mutex_};
+                list_.swap(pending_);
+            }
+            pending_.reset();
+            epoch_ = hdr.epoch;
+            return Ack(hdr);
+        default:
+            return false;
+        }
+    }
+
+    auto Ack(const FrameHeader &hdr) -> bool {
+        applied_seq_ = hdr.seq;
+        FrameHeader ack {FrameType::Ack, 0, hdr.seq, hdr.stamp_ns, hdr.epoch};
+        return replication::WriteAll(fd_, &ack, sizeof(ack));
+    }
+
+private:
+    int max_height_;
+    std::unique_ptr<SkipList<K, V>> list_;
+    std::unique_ptr<SkipList<K, V>> pending_;
+    std::shared_mutex list_mutex_;
+
+    uint64_t pending_seq_ {0};  // log position `pending_` is complete up to
+    uint64_t pending_epoch_ {0};
+    std::vector<LogEntry<K, V>> batch_;
+    std::vector<replication::SnapshotRecord<K, V>> chunk_;
+
+    int fd_ {-1};
+    std::atomic<bool> connected_ {false};
+    std::atomic<uint64_t> applied_seq_ {0};
+    uint64_t epoch_ {0};  // log the applied sequence belongs to, 0 before anything was applied
+    std::thread applier_;
+};
+
+}  // namespace kvstore
@@ -0,0 +1,154 @@
+# pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace kvstore {
+
+namespace details {
+
+/**
+ * Shard of the calling thread, handed out round-robin on first use so
+ * threads spread evenly over the cells. Masked by each counter's shard count.
+ */
+inline auto ThreadShard() -> uint32_t {
+    static std::atomic<uint32_t> next {0};
+    thread_local const uint32_t shard = next.fetch_add(1, std::memory_order_relaxed);
+    return shard;
+}
+
+//! two cells per hardware thread keeps collisions rare, a power of two in [8, 128]
+inline auto DefaultShards() -> uint32_t {
+    uint32_t want = std::max(2 * std::thread::hardware_concurrency(), 8u);
+    uint32_t shards = 1;
+    while (shards < want && shards < 128) {
+        shards <<= 1;
+    }
+    return shards;
+}
+
+}  // namespace details
+
+/**
+ * Counter split over cache-line sized cells. A thread only ever adds to its
+ * own cell, so concurrent updates from different cores do not bounce one
+ * line between them; Read() sums the cells and is the only O(shards) call.
+ *
+ * Read() is exact once writers are quiescent; while they run it may count
+ * some of the updates racing with the scan and miss others. Good enough for
+ * sizes and statistics, not for decisions that need a linearizable count.
+ */
+class ShardedCounter {
+public:
+    //! `shards` is rounded up to a power of two, at least 1
+    explicit ShardedCounter(uint32_t shards=details::DefaultShards())
+        : mask_(ShardMask(shards)), cells_(new Cell[mask_ + 1]) {}
+
+    ShardedCounter(const ShardedCounter &) = delete;
+    ShardedCounter &operator=(const ShardedCounter &) = delete;
+
+    void Add(int64_t n=1) {
+        cells_[details::ThreadShard() & mask_].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    void Sub(int64_t n=1) {
+        Add(-n);
+    }
+
+    auto Read() const -> int64_t {
+        int64_t sum = 0;
+        for (uint32_t i = 0; i <= mask_; ++i) {
+            sum += cells_[i].value.load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+
+    //! not atomic with respect to concurrent Add
+    void Reset() {
+        for (uint32_t i = 0; i <= mask_; ++i) {
+            cells_[i].value.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    auto Shards() const -> uint32_t {
+        return mask_ + 1;
+    }
+
+private:
+    struct alignas(64) Cell {
+        std::atomic<int64_t> value {0};
+    };
+
+    static auto ShardMask(uint32_t shards) -> uint32_t {
+        uint32_t rounded = 1;
+        while (rounded < shards && rounded < (1u << 31)) {
+            rounded <<= 1;
+        }
+        return rounded - 1;
+    }
+
+    uint32_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+};
+
+/**
+ * Named sharded counters, created on first use and never removed, so the
+ * reference Counter() returns stays valid and can be cached by hot paths.
+ */
+class CounterRegistry {
+public:
+    CounterRegistry() = default;
+    CounterRegistry(const CounterRegistry &) = delete;
+    CounterRegistry &operator=(const CounterRegistry &) = delete;
+
+    auto Counter(const std::string &name) -> ShardedCounter & {
+        std::lock_guard<std::mutex> lk{mutex_};
+        auto &counter = counters_[name];
+        if (!counter) {
+            counter = std::make_unique<ShardedCounter>();
+        }
+        return *counter;
+    }
+
+    /**
+     * @brief every counter's current sum, by name
+     */
+    auto Snapshot() const -> std::vector<std::pair<std::string, int64_t>> {
+        std::vector<std::pair<std::string, int64_t>> values;
+        std::lock_guard<std::mutex> lk{mutex_};
+        for (const auto &[name, counter] : counters_) {
+            values.emplace_back(name, counter->Read());
+        }
+        return values;
+    }
+
+    void Reset() {
+        std::lock_guard<std::mutex> lk{mutex_};
+        for (auto &[name, counter] : counters_) {
+            counter->Reset();
+        }
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::map<std::string, std::unique_ptr<ShardedCounter>> counters_;
+};
+
+inline auto operator<<(std::ostream &os, const CounterRegistry &registry) -> std::ostream & {
+    os << "[counters]";
+    for (const auto &[name, value] : registry.Snapshot()) {
+        os << " " << name << "=" << value;
+    }
+    return os << "\n";
+}
+
+}  // namespace kvstore
@@ -1,13 +1,27 @@
 # pragma once
 
 #include <cmath>
+#include <cstdint>
 #include <random>
 #include <vector>
 #include <utility>
 #include <mutex>
+#include <atomic>
+#include <functional>
+
+#include "skiplist_stats.h"
 
 namespace kvstore {
 
+/**
+ * Kind of mutation applied to a SkipList, reported to the mutation listener.
+ */
+enum class LogOp : uint8_t {
+    Put,
+    Remove,
+    RemoveRange,  // range tombstone for [key, end)
+};
+
 template <typename K, typename V>
 class SkipNode {
 
@@ -47,20 +61,27 @@ public:
         return below_;
     }
 
-    auto SkipSearch(K key) -> std::pair<SkipNode *, std::vector<SkipNode *>> {
+    auto SkipSearch(K key, SearchCost *cost=nullptr) -> std::pair<SkipNode *, std::vector<SkipNode *>> {
         auto curr = this;
         std::vector<SkipNode *> path;
         SkipNode * prev = nullptr;
+        uint32_t moves = 0;
 
         do {
             while(curr->ShouldSkipRight(key)) {
                 curr = curr->after_;
+                moves += 1;
             }
             path.push_back(curr);
             prev = curr;
             curr = curr->below_;
         } while(curr != nullptr);
 
+        if (cost != nullptr) {
+            // every right move took a comparison, plus the one that stopped each level
+            cost->levels = path.size();
+            cost->comparisons = moves + path.size();
+        }
         return {prev, path};
     }
 
@@ -89,8 +110,8 @@ class SkipList {
 public:
     explicit SkipList(int max_height=10) : max_height_(max_height) {
         //! create first layer of sentinel nodes
-        head = new SkipNode<int, int>(K{}, V{}, true);
-        auto tail = new SkipNode<int, int>(K{}, V{}, true);
+        head = new SkipNode<K, V>(K{}, V{}, true);
+        auto tail = new SkipNode<K, V>(K{}, V{}, true);
         head->After() = tail;
         tail->Before() = head;
         curr_height_ = 1;
@@ -117,16 +138,89 @@ public:
     }
 
     auto Size() const -> int {
-        return curr_size_;
+        return curr_size_.load(std::memory_order_relaxed);
     }
 
     auto Search(K key) -> SkipNode<K, V> * {
-        return head->SkipSearch(key).first;
+        auto match = Descend(key).first;
+        Count(&ThreadStats<K>::searches, key);
+        return match;
     }
 
-    auto Insert(K key, V value) -> bool {
+    /**
+     * @brief sum of every thread's access counters, empty when built with
+     *        KVSTORE_ENABLE_STATS=0
+     */
+    auto Stats(size_t top_keys=10) -> SkipListStats<K> {
+#if KVSTORE_ENABLE_STATS
+        return stats_.Snapshot(top_keys);
+#else
+        return {};
+#endif
+    }
+
+    /**
+     * @brief register a callback invoked for every successful mutation,
+     *        while the list mutex is still held, so the callback observes
+     *        mutations in exactly the order they were applied. `end` is the
+     *        exclusive upper bound of a RemoveRange and equals `key` otherwise.
+     */
+    void SetMutationListener(std::function<void(LogOp op, const K &key, const V &value, const K &end)> listener) {
         std::lock_guard<std::mutex> lk{mutex_};
-        auto search_pair = head->SkipSearch(key);
+        listener_ = std::move(listener);
+    }
+
+    /**
+     * @brief visit every entry in key order under the list mutex.
+     *        `before` runs first inside the same critical section, which lets
+     *        callers pair the visited contents with a consistent log position.
+     */
+    template <typename F, typename B>
+    void ForEach(F &&fn, B &&before) {
+        std::lock_guard<std::mutex> lk{mutex_};
+        before();
+        auto bottom = head;
+        while (bottom->Below() != nullptr) {
+            bottom = bottom->Below();
+        }
+        for (auto curr = bottom->After(); !curr->IsSentinel(); curr = curr->After()) {
+            fn(curr->Key(), curr->Value());
+        }
+    }
+
+    template <typename F>
+    void ForEach(F &&fn) {
+        ForEach(std::forward<F>(fn), [] {});
+    }
+
+    /**
+     * @brief visit at most `max` entries with keys above `*after` (from the
+     *        first entry when `after` is null) in key order, holding the list
+     *        mutex only for those entries
+     * @return number of entries visited, fewer than `max` at the end of the list
+     */
+    template <typename F>
+    auto ForEachAfter(const K *after, size_t max, F &&fn) -> size_t {
+        std::lock_guard<std::mutex> lk{mutex_};
+        auto curr = head;
+        if (after != nullptr) {
+            curr = head->SkipSearch(*after).first;
+        } else {
+            while (curr->Below() != nullptr) {
+                curr = curr->Below();
+            }
+        }
+        size_t visited = 0;
+        for (curr = curr->After(); visited < max && !curr->IsSentinel(); curr = curr->After()) {
+            fn(curr->Key(), curr->Value());
+            visited += 1;
+        }
+        return visited;
+    }
+
+    auto Insert(K key, V value) -> bool {
+        auto lk = Lock();
+        auto search_pair = Descend(key);
         auto match = search_pair.first;
         auto path = search_pair.second;
 
@@ -137,6 +231,10 @@ public:
                 curr->SetValue(value);
                 curr = curr->Above();
             }
+            Count(&ThreadStats<K>::updates, key);
+            if (listener_) {
+                listener_(LogOp::Put, key, value, key);
+            }
             return false;
         }
 
@@ -149,7 +247,7 @@ public:
                 BuildExtraLayer();
             }
             // refetch the search path(not optimal)
-            path = head->SkipSearch(key).second;
+            path = Descend(key).second;
         }
         // build the new node all the way up, after each path[i]
         SkipNode<K, V> *last = nullptr;
@@ -167,15 +265,19 @@ public:
             }
             last = new_node;
         }
-        curr_size_ += 1;
+        curr_size_.store(curr_size_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
         // dynamic update max height
         max_height_ = std::max(max_height_, ExpectHeight());
+        Count(&ThreadStats<K>::inserts, key);
+        if (listener_) {
+            listener_(LogOp::Put, key, value, key);
+        }
         return true;
     }
 
     auto Remove(K key) -> bool {
-        std::lock_guard<std::mutex> lk{mutex_};
-        auto search_pair = head->SkipSearch(key);
+        auto lk = Lock();
+        auto search_pair = Descend(key);
         auto match = search_pair.first;
         
         if (match->Key() == key && !match->IsSentinel()) {
@@ -190,17 +292,111 @@ public:
                 after->Before() = before;
                 delete temp;
             }
-            curr_size_ -= 1;
+            curr_size_.store(curr_size_.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+            Count(&ThreadStats<K>::removes, key);
+            if (listener_) {
+                listener_(LogOp::Remove, key, V{}, key);
+            }
             return true;
         }
         // key doesn't exsit.
+        Count(&ThreadStats<K>::remove_misses, key);
         return false;
     }
 
+    /**
+     * @brief remove every key in [lo, hi) with a single descent: on each
+     *        level the whole span is unlinked at once and its nodes freed
+     *        in one sweep, instead of a search and a tower walk per key.
+     * @return number of keys removed
+     */
+    auto RemoveRange(K lo, K hi) -> int {
+        if (!(lo < hi)) {
+            return 0;
+        }
+        auto lk = Lock();
+        auto path = Descend(lo).second;
+        int removed = 0;
+        for (auto left : path) {
+            // path[i] is the largest key <= lo, the span starts right after
+            // the largest key < lo
+            if (!left->IsSentinel() && left->Key() == lo) {
+                left = left->Before();
+            }
+            bool bottom = left->Below() == nullptr;
+            auto curr = left->After();
+            while (!curr->IsSentinel() && curr->Key() < hi) {
+                auto next = curr->After();
+                delete curr;
+                removed += bottom;
+                curr = next;
+            }
+            left->After() = curr;
+            curr->Before() = left;
+        }
+        curr_size_.store(curr_size_.load(std::memory_order_relaxed) - removed, std::memory_order_relaxed);
+        CountRange(removed);
+        if (removed > 0 && listener_) {
+            listener_(LogOp::RemoveRange, lo, V{}, hi);
+        }
+        return removed;
+    }
+
 private:
 
+#if KVSTORE_ENABLE_STATS
+    auto Lock() -> std::unique_lock<std::mutex> {
+        std::unique_lock<std::mutex> lk{mutex_, std::try_to_lock};
+        auto &cell = stats_.Local();
+        ThreadStats<K>::Bump(cell.lock_acquisitions);
+        if (!lk.owns_lock()) {
+            // only the contended path pays for reading the clock
+            auto start = std::chrono::steady_clock::now();
+            lk.lock();
+            auto waited = std::chrono::steady_clock::now() - start;
+            ThreadStats<K>::Bump(cell.lock_contended);
+            ThreadStats<K>::Bump(cell.lock_wait_ns, std::chrono::duration_cast<std::chrono::nanoseconds>(waited).count());
+        }
+        return lk;
+    }
+
+    auto Descend(K key) -> std::pair<SkipNode<K, V> *, std::vector<SkipNode<K, V> *>> {
+        SearchCost cost;
+        auto result = head->SkipSearch(key, &cost);
+        auto &cell = stats_.Local();
+        ThreadStats<K>::Bump(cell.descents);
+        ThreadStats<K>::Bump(cell.comparisons, cost.comparisons);
+        ThreadStats<K>::Bump(cell.levels, cost.levels);
+        return result;
+    }
+
+    void Count(std::atomic<uint64_t> ThreadStats<K>::*counter, const K &key) {
+        auto &cell = stats_.Local();
+        ThreadStats<K>::Bump(cell.*counter);
+        stats_.RecordKey(cell, key);
+    }
+
+    void CountRange(int removed) {
+        auto &cell = stats_.Local();
+        ThreadStats<K>::Bump(cell.range_removes);
+        ThreadStats<K>::Bump(cell.removes, removed);
+    }
+#else
+    auto Lock() -> std::unique_lock<std::mutex> {
+        return std::unique_lock<std::mutex>{mutex_};
+    }
+
+    auto Descend(K key) -> std::pair<SkipNode<K, V> *, std::vector<SkipNode<K, V> *>> {
+        return head->SkipSearch(key);
+    }
+
+    void Count(std::atomic<uint64_t> ThreadStats<K>::*, const K &) {}
+
+    void CountRange(int) {}
+#endif
+
     auto ExpectHeight() -> int {
-        return static_cast<int>(log2(curr_size_) + 2);
+        return static_cast<int>(log2(curr_size_.load(std::memory_order_relaxed)) + 2);
     }
 
     void BuildExtraLayer() {
@@ -233,10 +429,15 @@ private:
 private:
     int max_height_;
     int curr_height_ {0};
-    int curr_size_ {0};
+    //! only written under mutex_; atomic so Size() can read it without the mutex
+    std::atomic<int> curr_size_ {0};
     SkipNode<K, V> * head {nullptr};
     
     std::mutex mutex_;
+    std::function<void(LogOp, const K &, const V &, const K &)> listener_;
+#if KVSTORE_ENABLE_STATS
+    StatsRegistry<K> stats_;
+#endif
 };
 
 }
@@ -0,0 +1,368 @@
+# pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+//! build with -DKVSTORE_ENABLE_STATS=0 to compile every counter out of SkipList
+#ifndef KVSTORE_ENABLE_STATS
+#define KVSTORE_ENABLE_STATS 1
+#endif
+
+namespace kvstore {
+
+/**
+ * Cost of one top-to-bottom descent, filled in by SkipNode::SkipSearch.
+ */
+struct SearchCost {
+    uint32_t comparisons {0};
+    uint32_t levels {0};
+};
+
+/**
+ * Space-saving heavy hitters sketch (Metwally et al.): keeps `capacity`
+ * counters, and an unseen key evicts the smallest one and inherits its count
+ * as the over-estimation error. Any key accessed more often than
+ * total / capacity is guaranteed to be tracked.
+ */
+template <typename K>
+class SpaceSaving {
+public:
+    struct Counter {
+        K key;
+        uint64_t count;
+        uint64_t error;
+    };
+
+    explicit SpaceSaving(size_t capacity=32) : capacity_(capacity) {
+        counters_.reserve(capacity);
+    }
+
+    void Offer(const K &key, uint64_t weight=1) {
+        for (auto &c : counters_) {
+            if (c.key == key) {
+                c.count += weight;
+                return;
+            }
+        }
+        if (counters_.size() < capacity_) {
+            counters_.push_back({key, weight, 0});
+            return;
+        }
+        auto min = std::min_element(counters_.begin(), counters_.end(),
+                                    [](const Counter &a, const Counter &b) { return a.count < b.count; });
+        min->key = key;
+        min->error = min->count;
+        min->count += weight;
+    }
+
+    auto Counters() const -> const std::vector<Counter> & {
+        return counters_;
+    }
+
+private:
+    size_t capacity_;
+    std::vector<Counter> counters_;
+};
+
+/**
+ * Counters owned by one thread. Only the owner writes them, so a relaxed
+ * load + store is enough and no read-modify-write ever crosses cores; the
+ * cell is cache-line aligned so neighbouring threads do not false-share.
+ */
+template <typename K>
+struct alignas(64) ThreadStats {
+    std::atomic<uint64_t> searches {0};
+    std::atomic<uint64_t> inserts {0};
+    std::atomic<uint64_t> updates {0};
+    std::atomic<uint64_t> removes {0};
+    std::atomic<uint64_t> remove_misses {0};
+    std::atomic<uint64_t> range_removes {0};
+
+    std::atomic<uint64_t> descents {0};
+    std::atomic<uint64_t> comparisons {0};
+    std::atomic<uint64_t> levels {0};
+
+    std::atomic<uint64_t> lock_acquisitions {0};
+    std::atomic<uint64_t> lock_contended {0};
+    std::atomic<uint64_t> lock_wait_ns {0};
+
+    //! the sketch is only touched every 2^sample_shift accesses
+    uint32_t sample_tick {0};
+    std::mutex hot_mutex;
+    SpaceSaving<K> hot_keys;
+
+    static void Bump(std::atomic<uint64_t> &counter, uint64_t n=1) {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+};
+
+/**
+ * Point-in-time sum of every thread's counters.
+ */
+template <typename K>
+struct SkipListStats {
+    uint64_t searches {0};
+    uint64_t inserts {0};
+    uint64_t updates {0};
+    uint64_t removes {0};
+    uint64_t remove_misses {0};
+    uint64_t range_removes {0};
+
+    uint64_t descents {0};
+    uint64_t comparisons {0};
+    uint64_t levels {0};
+
+    uint64_t lock_acquisitions {0};
+    uint64_t lock_contended {0};
+    uint64_t lock_wait_ns {0};
+
+    //! per-thread cells the counters were summed over
+    uint64_t threads {0};
+
+    //! estimated access counts, hottest first
+    std::vector<std::pair<K, uint64_t>> hot_keys;
+
+    auto ComparisonsPerSearch() const -> double {
+        return descents ? static_cast<double>(comparisons) / descents : 0.0;
+    }
+
+    auto LevelsPerSearch() const -> double {
+        return descents ? static_cast<double>(levels) / descents : 0.0;
+    }
+};
+
+template <typename K>
+auto operator<<(std::ostream &os, const SkipListStats<K> &s) -> std::ostream & {
+    os << "[skiplist stats] searches=" << s.searches << " inserts=" << s.inserts
+       << " updates=" << s.updates << " removes=" << s.removes
+       << " remove_misses=" << s.remove_misses << " range_removes=" << s.range_removes << "\n"
+       << "  cmp/search=" << s.ComparisonsPerSearch() << " levels/search=" << s.LevelsPerSearch()
+       << " lock contended=" << s.lock_contended << "/" << s.lock_acquisitions
+       << " wait=" << s.lock_wait_ns / 1000 << "us threads=" << s.threads << "\n"
+       << "  hot keys:";
+    for (const auto &[key, count] : s.hot_keys) {
+        os << " " << key << "(" << count << ")";
+    }
+    return os << "\n";
+}
+
+namespace details {
+
+/**
+ * Hands every live thread a small index and takes it back when the thread
+ * exits, so indexes stay below the peak number of threads alive at once.
+ */
+class ThreadIndexPool {
+public:
+    auto Acquire() -> uint32_t {
+        std::lock_guard<std::mutex> lk{mutex_};
+        if (free_.empty()) {
+            return next_++;
+        }
+        auto index = free_.back();
+        free_.pop_back();
+        return index;
+    }
+
+    void Release(uint32_t index) {
+        std::lock_guard<std::mutex> lk{mutex_};
+        free_.push_back(index);
+    }
+
+    static auto Instance() -> ThreadIndexPool & {
+        static ThreadIndexPool pool;
+        return pool;
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<uint32_t> free_;
+    uint32_t next_ {0};
+};
+
+inline auto StatsThreadIndex() -> uint32_t {
+    struct Holder {
+        uint32_t index {ThreadIndexPool::Instance().Acquire()};
+        ~Holder() {
+            ThreadIndexPool::Instance().Release(index);
+        }
+    };
+    thread_local Holder holder;
+    return holder.index;
+}
+
+}  // namespace details
+
+/**
+ * Owns the per-thread cells of one SkipList, found by the calling thread's
+ * index without a lock: a fixed table of pages, each created on first use,
+ * maps the index to its cell. A thread that inherits the index of an exited
+ * one carries on counting in the old cell, so there is one cell per thread
+ * alive at once, however many lists a thread touches.
+ */
+template <typename K>
+class StatsRegistry {
+    static constexpr size_t kPageSize = 64;
+    static constexpr size_t kPages = 64;
+
+    using Slot = std::atomic<ThreadStats<K> *>;
+
+public:
+    explicit StatsRegistry(uint32_t sample_shift=3) : sample_shift_(sample_shift) {}
+
+    ~StatsRegistry() {
+        for (auto &page : pages_) {
+            delete[] page.load(std::memory_order_relaxed);
+        }
+    }
+
+    StatsRegistry(const StatsRegistry &) = delete;
+    StatsRegistry &operator=(const StatsRegistry &) = delete;
+
+    auto Local() -> ThreadStats<K> & {
+        auto index = details::StatsThreadIndex();
+        if (index < kPages * kPageSize) {
+            auto page = pages_[index / kPageSize].load(std::memory_order_acquire);
+            if (page != nullptr) {
+                auto cell = page[index % kPageSize].load(std::memory_order_acquire);
+                if (cell != nullptr) {
+                    return *cell;
+                }
+            }
+        }
+        return NewCell(index);
+    }
+
+    /**
+     * @brief count one access to `key` in the calling thread's sketch
+     */
+    void RecordKey(ThreadStats<K> &cell, const K &key) {
+        auto mask = (1u << sample_shift_) - 1;
+        if ((cell.sample_tick++ & mask) != 0) {
+            return;
+        }
+        std::lock_guard<std::mutex> lk{cell.hot_mutex};
+        cell.hot_keys.Offer(key, uint64_t{1} << sample_shift_);
+    }
+
+    auto Snapshot(size_t top=10) -> SkipListStats<K> {
+        SkipListStats<K> s;
+        std::vector<std::pair<K, uint64_t>> hot;
+        std::lock_guard<std::mutex> lk{mutex_};
+        s.threads = cells_.size();
+        for (auto &cell : cells_) {
+            s.searches += cell->searches.load(std::memory_order_relaxed);
+            s.inserts += cell->inserts.load(std::memory_order_relaxed);
+            s.updates += cell->updates.load(std::memory_order_relaxed);
+            s.removes += cell->removes.load(std::memory_order_relaxed);
+            s.remove_misses += cell->remove_misses.load(std::memory_order_relaxed);
+            s.range_removes += cell->range_removes.load(std::memory_order_relaxed);
+            s.descents += cell->descents.load(std::memory_order_relaxed);
+            s.comparisons += cell->comparisons.load(std::memory_order_relaxed);
+            s.levels += cell->levels.load(std::memory_order_relaxed);
+            s.lock_acquisitions += cell->lock_acquisitions.load(std::memory_order_relaxed);
+            s.lock_contended += cell->lock_contended.load(std::memory_order_relaxed);
+            s.lock_wait_ns += cell->lock_wait_ns.load(std::memory_order_relaxed);
+
+            std::lock_guard<std::mutex> hot_lk{cell->hot_mutex};
+            for (const auto &c : cell->hot_keys.Counters()) {
+                auto it = std::find_if(hot.begin(), hot.end(), [&](const auto &h) { return h.first == c.key; });
+                if (it != hot.end()) {
+                    it->second += c.count;
+                } else {
+                    hot.emplace_back(c.key, c.count);
+                }
+            }
+        }
+        std::sort(hot.begin(), hot.end(), [](const auto &a, const auto &b) { return a.second > b.second; });
+        if (hot.size() > top) {
+            hot.resize(top);
+        }
+        s.hot_keys = std::move(hot);
+        return s;
+    }
+
+private:
+    //! first use of the registry by the thread holding `index`
+    auto NewCell(uint32_t index) -> ThreadStats<K> & {
+        std::lock_guard<std::mutex> lk{mutex_};
+        if (index >= kPages * kPageSize) {
+            // past the table, such threads look their cell up under the mutex
+            auto &cell = overflow_[index];
+            if (cell == nullptr) {
+                cell = AddCell();
+            }
+            return *cell;
+        }
+        auto &slot = pages_[index / kPageSize];
+        auto page = slot.load(std::memory_order_relaxed);
+        if (page == nullptr) {
+            page = new Slot[kPageSize]();
+            slot.store(page, std::memory_order_release);
+        }
+        auto cell = AddCell();
+        page[index % kPageSize].store(cell, std::memory_order_release);
+        return *cell;
+    }
+
+    auto AddCell() -> ThreadStats<K> * {
+        cells_.push_back(std::make_unique<ThreadStats<K>>());
+        return cells_.back().get();
+    }
+
+    uint32_t sample_shift_;
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<ThreadStats<K>>> cells_;
+    std::atomic<Slot *> pages_[kPages] {};
+    std::unordered_map<uint32_t, ThreadStats<K> *> overflow_;
+};
+
+/**
+ * Writes `list.Stats()` to `out` every `interval` until destroyed.
+ */
+template <typename List>
+class StatsReporter {
+public:
+    StatsReporter(List &list, std::chrono::milliseconds interval, std::ostream &out=std::cerr)
+        : list_(list), interval_(interval), out_(out), worker_([this] { Run(); }) {}
+
+    ~StatsReporter() {
+        {
+            std::lock_guard<std::mutex> lk{mutex_};
+            stop_ = true;
+        }
+        cond_.notify_one();
+        worker_.join();
+    }
+
+    StatsReporter(const StatsReporter &) = delete;
+    StatsReporter &operator=(const StatsReporter &) = delete;
+
+private:
+    void Run() {
+        std::unique_lock<std::mutex> lk{mutex_};
+        while (!cond_.wait_for(lk, interval_, [this] { return stop_; })) {
+            out_ << list_.Stats();
+        }
+    }
+
+    List &list_;
+    std::chrono::milliseconds interval_;
+    std::ostream &out_;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    bool stop_ {false};
+    std::thread worker_;
+};
+
+}  // namespace kvstore
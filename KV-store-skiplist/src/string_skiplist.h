@@ -0,0 +1,472 @@
+# pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace kvstore {
+
+/**
+ * Bump allocator for key bytes. Keys are copied in once and never move.
+ * Each key takes a power-of-two size class; a released key's bytes go on
+ * that class's free list and are handed to the next key of the class, so
+ * separators retired by block merges are reused instead of piling up.
+ * Chunks are only returned when the arena is destroyed.
+ */
+class KeyArena {
+    static constexpr size_t kChunkSize = 64 * 1024;
+    static constexpr size_t kMinClass = 8;  // room for the free list link
+    static constexpr int kClasses = 14;  // kMinClass << 13 == kChunkSize
+
+public:
+    auto Store(std::string_view key) -> std::string_view {
+        if (key.size() > kChunkSize) {
+            // oversized keys get a chunk of their own, the current one stays open
+            chunks_.push_back(std::make_unique<char[]>(key.size()));
+            allocated_ += key.size();
+            std::memcpy(chunks_.back().get(), key.data(), key.size());
+            return {chunks_.back().get(), key.size()};
+        }
+        auto cls = SizeClass(key.size());
+        auto mem = free_[cls];
+        if (mem != nullptr) {
+            std::memcpy(&free_[cls], mem, sizeof(char *));
+        } else {
+            auto size = kMinClass << cls;
+            if (size > remaining_) {
+                chunks_.push_back(std::make_unique<char[]>(kChunkSize));
+                allocated_ += kChunkSize;
+                cursor_ = chunks_.back().get();
+                remaining_ = kChunkSize;
+            }
+            mem = cursor_;
+            cursor_ += size;
+            remaining_ -= size;
+        }
+        std::memcpy(mem, key.data(), key.size());
+        return {mem, key.size()};
+    }
+
+    /**
+     * @brief give back the bytes of a key returned by Store
+     */
+    void Release(std::string_view key) {
+        auto mem = const_cast<char *>(key.data());
+        if (key.size() > kChunkSize) {
+            auto it = std::find_if(chunks_.begin(), chunks_.end(),
+                                   [&](const auto &chunk) { return chunk.get() == mem; });
+            chunks_.erase(it);
+            allocated_ -= key.size();
+            return;
+        }
+        auto cls = SizeClass(key.size());
+        std::memcpy(mem, &free_[cls], sizeof(char *));
+        free_[cls] = mem;
+    }
+
+    auto MemoryUsage() const -> size_t {
+        return allocated_;
+    }
+
+private:
+    /**
+     * @brief index of the smallest class of kMinClass << i bytes holding `size`
+     */
+    static auto SizeClass(size_t size) -> int {
+        int cls = 0;
+        while ((kMinClass << cls) < size) {
+            cls += 1;
+        }
+        return cls;
+    }
+
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    char *cursor_ {nullptr};
+    size_t remaining_ {0};
+    size_t allocated_ {0};
+    char *free_[kClasses] {};
+};
+
+namespace strkey {
+
+/**
+ * @brief the first 8 bytes of `key` packed big-endian and zero padded, so
+ *        comparing two prefixes as integers orders them like the strings
+ */
+inline auto Prefix(std::string_view key) -> uint64_t {
+    uint64_t prefix = 0;
+    auto n = std::min<size_t>(key.size(), 8);
+    for (size_t i = 0; i < n; ++i) {
+        prefix |= static_cast<uint64_t>(static_cast<unsigned char>(key[i])) << (56 - 8 * i);
+    }
+    return prefix;
+}
+
+inline void PutVarint(std::string &out, uint32_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+inline auto GetVarint(const char *&p) -> uint32_t {
+    uint32_t v = 0;
+    for (int shift = 0;; shift += 7) {
+        auto byte = static_cast<unsigned char>(*p++);
+        v |= static_cast<uint32_t>(byte & 0x7f) << shift;
+        if (byte < 0x80) {
+            return v;
+        }
+    }
+}
+
+}  // namespace strkey
+
+/**
+ * A skiplist specialised for long, highly prefixed string keys.
+ *
+ * The bottom level is a chain of blocks holding up to kBlockCapacity sorted
+ * entries, each key stored LevelDB style as (shared prefix length with the
+ * previous key, suffix). The upper levels are a tower-per-node skiplist over
+ * the first key of every block: each separator is stored once in a KeyArena,
+ * whatever the height of its tower, and carries an 8 byte big-endian prefix
+ * so most comparisons are a single integer compare.
+ */
+template <typename V>
+class StringSkipList {
+    static constexpr int kMaxHeight = 12;
+    static constexpr size_t kBlockCapacity = 32;
+
+    struct Block {
+        std::string data;  // (varint shared, varint unshared, suffix bytes) per entry
+        std::vector<V> values;
+    };
+
+    struct IndexNode {
+        uint64_t prefix;
+        std::string_view key;  // first key of `block`, lives in the arena
+        Block *block;
+        int height;
+        IndexNode *next[1];  // really `height` entries
+    };
+
+    struct Probe {
+        size_t index;  // first entry >= key
+        bool found;
+    };
+
+public:
+    StringSkipList() {
+        head_ = NewIndexNode({}, new Block, kMaxHeight);
+    }
+
+    ~StringSkipList() {
+        auto node = head_;
+        while (node != nullptr) {
+            auto next = node->next[0];
+            delete node->block;
+            FreeIndexNode(node);
+            node = next;
+        }
+    }
+
+    StringSkipList(const StringSkipList &) = delete;
+    StringSkipList &operator=(const StringSkipList &) = delete;
+
+    auto Size() const -> int {
+        return curr_size_;
+    }
+
+    /**
+     * @brief bytes held by the arena, blocks and index nodes
+     */
+    auto MemoryUsage() -> size_t {
+        std::shared_lock<std::shared_mutex> lk{mutex_};
+        size_t total = arena_.MemoryUsage();
+        for (auto node = head_; node != nullptr; node = node->next[0]) {
+            total += sizeof(IndexNode) + (node->height - 1) * sizeof(IndexNode *) + sizeof(Block) +
+                     node->block->data.capacity() + node->block->values.capacity() * sizeof(V);
+        }
+        return total;
+    }
+
+    auto Get(std::string_view key) -> std::optional<V> {
+        std::shared_lock<std::shared_mutex> lk{mutex_};
+        auto block = FindFloor(key, nullptr)->block;
+        auto probe = Find(*block, key);
+        if (!probe.found) {
+            return std::nullopt;
+        }
+        return block->values[probe.index];
+    }
+
+    auto Insert(std::string_view key, V value) -> bool {
+        std::unique_lock<std::shared_mutex> lk{mutex_};
+        IndexNode *prev[kMaxHeight];
+        auto node = FindFloor(key, prev);
+        auto block = node->block;
+        auto probe = Find(*block, key);
+        if (probe.found) {
+            block->values[probe.index] = value;
+            return false;
+        }
+
+        auto count = Decode(*block);
+        scratch_.emplace(scratch_.begin() + probe.index, key);
+        count += 1;
+        block->values.insert(block->values.begin() + probe.index, value);
+        if (count <= kBlockCapacity) {
+            Encode(*block, 0, count);
+        } else {
+            // split in half, the upper half becomes a new block in the index
+            auto half = count / 2;
+            auto upper = new Block;
+            Encode(*block, 0, half);
+            Encode(*upper, half, count);
+            upper->values.assign(block->values.begin() + half, block->values.end());
+            block->values.resize(half);
+            block->values.shrink_to_fit();
+            // no separator lies between `node` and the new one, so prev[] is
+            // also the predecessor of the new separator on every level
+            LinkAfter(prev, NewIndexNode(arena_.Store(scratch_[half]), upper, RandomHeight()));
+        }
+        curr_size_ += 1;
+        return true;
+    }
+
+    auto Remove(std::string_view key) -> bool {
+        std::unique_lock<std::shared_mutex> lk{mutex_};
+        auto node = FindFloor(key, nullptr);
+        auto block = node->block;
+        auto probe = Find(*block, key);
+        if (!probe.found) {
+            return false;
+        }
+
+        auto count = Decode(*block);
+        scratch_.erase(scratch_.begin() + probe.index);
+        count -= 1;
+        block->values.erase(block->values.begin() + probe.index);
+        Encode(*block, 0, count);
+        curr_size_ -= 1;
+
+        if (count == 0 && node != head_) {
+            Unlink(node);
+        } else if (count < kBlockCapacity / 4) {
+            MergeNext(node);
+        }
+        return true;
+    }
+
+private:
+    static auto NewIndexNode(std::string_view key, Block *block, int height) -> IndexNode * {
+        auto mem = ::operator new(sizeof(IndexNode) + (height - 1) * sizeof(IndexNode *));
+        auto node = static_cast<IndexNode *>(mem);
+        node->prefix = strkey::Prefix(key);
+        node->key = key;
+        node->block = block;
+        node->height = height;
+        for (int i = 0; i < height; ++i) {
+            node->next[i] = nullptr;
+        }
+        return node;
+    }
+
+    static void FreeIndexNode(IndexNode *node) {
+        ::operator delete(node);
+    }
+
+    /**
+     * @brief three way compare of a separator against `key`, touching the
+     *        separator bytes only when the cached prefixes tie
+     */
+    static auto Compare(const IndexNode *node, std::string_view key, uint64_t key_prefix) -> int {
+        if (node->prefix != key_prefix) {
+            return node->prefix < key_prefix ? -1 : 1;
+        }
+        return node->key.compare(key);
+    }
+
+    auto RandomHeight() -> int {
+        int height = 1;
+        while (height < kMaxHeight && rand() % 4 == 0) {
+            height += 1;
+        }
+        return height;
+    }
+
+    /**
+     * @brief the last index node whose separator is <= key (the head covers
+     *        -oo); fills `prev` with that node's counterpart on every level
+     */
+    auto FindFloor(std::string_view key, IndexNode **prev) -> IndexNode * {
+        auto key_prefix = strkey::Prefix(key);
+        auto curr = head_;
+        for (int level = kMaxHeight - 1; level >= 0; --level) {
+            while (curr->next[level] != nullptr && Compare(curr->next[level], key, key_prefix) <= 0) {
+                curr = curr->next[level];
+            }
+            if (prev != nullptr) {
+                prev[level] = curr;
+            }
+        }
+        return curr;
+    }
+
+    void LinkAfter(IndexNode **prev, IndexNode *node) {
+        for (int level = 0; level < node->height; ++level) {
+            node->next[level] = prev[level]->next[level];
+            prev[level]->next[level] = node;
+        }
+    }
+
+    /**
+     * @brief take `node` out of the index and free it with its block
+     */
+    void Unlink(IndexNode *node) {
+        auto key_prefix = node->prefix;
+        auto curr = head_;
+        for (int level = kMaxHeight - 1; level >= 0; --level) {
+            while (curr->next[level] != nullptr && curr->next[level] != node &&
+                   Compare(curr->next[level], node->key, key_prefix) < 0) {
+                curr = curr->next[level];
+            }
+            if (curr->next[level] == node) {
+                curr->next[level] = node->next[level];
+            }
+        }
+        arena_.Release(node->key);
+        delete node->block;
+        FreeIndexNode(node);
+    }
+
+    /**
+     * @brief fold the following block into `node`'s block when both fit
+     */
+    void MergeNext(IndexNode *node) {
+        auto next = node->next[0];
+        if (next == nullptr ||
+            node->block->values.size() + next->block->values.size() > kBlockCapacity / 2) {
+            return;
+        }
+        auto count = Decode(*node->block);
+        auto more = Decode(*next->block, count);
+        Encode(*node->block, 0, count + more);
+        auto &values = node->block->values;
+        values.insert(values.end(), next->block->values.begin(), next->block->values.end());
+        Unlink(next);
+    }
+
+    /**
+     * @brief locate `key` in a block without rebuilding any key: track the
+     *        common prefix length `match` of `key` and the previous entry,
+     *        and only look at suffix bytes when an entry shares exactly
+     *        `match` bytes with its predecessor
+     */
+    static auto Find(const Block &block, std::string_view key) -> Probe {
+        auto p = block.data.data();
+        auto end = p + block.data.size();
+        size_t match = 0;
+        for (size_t index = 0; p < end; ++index) {
+            auto shared = strkey::GetVarint(p);
+            auto unshared = strkey::GetVarint(p);
+            auto suffix = p;
+            p += unshared;
+            if (shared < match) {
+                // the entry leaves the previous key where that one still
+                // agreed with `key`, upwards: it is past `key`
+                return {index, false};
+            }
+            if (shared > match) {
+                // it still agrees with the previous key where that one was
+                // below `key`
+                continue;
+            }
+            auto rest = key.substr(match);
+            auto n = std::min<size_t>(unshared, rest.size());
+            size_t common = 0;
+            while (common < n && suffix[common] == rest[common]) {
+                common += 1;
+            }
+            if (common == n) {
+                if (unshared == rest.size()) {
+                    return {index, true};
+                }
+                if (unshared > rest.size()) {
+                    return {index, false};  // `key` is a prefix of the entry
+                }
+            } else if (static_cast<unsigned char>(suffix[common]) > static_cast<unsigned char>(rest[common])) {
+                return {index, false};
+            }
+            match += common;
+        }
+        return {block.values.size(), false};
+    }
+
+    /**
+     * @brief expand the keys of `block` into scratch_[at, ...)
+     * @return number of keys decoded
+     */
+    auto Decode(const Block &block, size_t at=0) -> size_t {
+        auto p = block.data.data();
+        auto end = p + block.data.size();
+        size_t count = 0;
+        std::string_view prev;
+        if (scratch_.size() < at + block.values.size()) {
+            scratch_.resize(at + block.values.size());
+        }
+        while (p < end) {
+            auto shared = strkey::GetVarint(p);
+            auto unshared = strkey::GetVarint(p);
+            auto &key = scratch_[at + count];
+            // `prev` aliases the previous scratch string, which `key` is not
+            key.assign(prev.data(), shared);
+            key.append(p, unshared);
+            p += unshared;
+            prev = key;
+            count += 1;
+        }
+        scratch_.resize(at + count);
+        return count;
+    }
+
+    /**
+     * @brief rewrite `block`'s key bytes from scratch_[from, to)
+     */
+    void Encode(Block &block, size_t from, size_t to) {
+        block.data.clear();
+        std::string_view prev;
+        for (auto i = from; i < to; ++i) {
+            std::string_view key = scratch_[i];
+            size_t shared = 0;
+            auto n = std::min(prev.size(), key.size());
+            while (shared < n && prev[shared] == key[shared]) {
+                shared += 1;
+            }
+            strkey::PutVarint(block.data, shared);
+            strkey::PutVarint(block.data, key.size() - shared);
+            block.data.append(key.data() + shared, key.size() - shared);
+            prev = key;
+        }
+        block.data.shrink_to_fit();
+    }
+
+private:
+    IndexNode *head_;
+    KeyArena arena_;
+    int curr_size_ {0};
+    std::vector<std::string> scratch_;  // decoded keys of the block being rewritten
+    std::shared_mutex mutex_;
+};
+
+}  // namespace kvstore
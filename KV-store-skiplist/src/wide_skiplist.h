@@ -0,0 +1,359 @@
+# pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <type_traits>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace kvstore {
+
+namespace wide {
+
+/**
+ * @brief number of keys in the sorted block `keys[0, count)` that are <= key.
+ *        The compare runs over the whole block of B keys with SIMD and the
+ *        result is masked to `count`, so there is no data dependent branch.
+ */
+template <typename K, int B>
+inline auto Rank(const K *keys, int count, K key) -> int {
+    static_assert(B <= 64, "the compare mask is 64 bits wide");
+    uint64_t greater = 0;
+#if defined(__AVX2__)
+    if constexpr (std::is_signed_v<K> && sizeof(K) == 4 && B % 8 == 0) {
+        auto target = _mm256_set1_epi32(static_cast<int32_t>(key));
+        for (int i = 0; i < B; i += 8) {
+            auto block = _mm256_load_si256(reinterpret_cast<const __m256i *>(keys + i));
+            auto gt = _mm256_cmpgt_epi32(block, target);
+            greater |= static_cast<uint64_t>(_mm256_movemask_ps(_mm256_castsi256_ps(gt))) << i;
+        }
+    } else if constexpr (std::is_signed_v<K> && sizeof(K) == 8 && B % 4 == 0) {
+        auto target = _mm256_set1_epi64x(static_cast<int64_t>(key));
+        for (int i = 0; i < B; i += 4) {
+            auto block = _mm256_load_si256(reinterpret_cast<const __m256i *>(keys + i));
+            auto gt = _mm256_cmpgt_epi64(block, target);
+            greater |= static_cast<uint64_t>(_mm256_movemask_pd(_mm256_castsi256_pd(gt))) << i;
+        }
+    } else
+#elif defined(__SSE2__)
+    if constexpr (std::is_signed_v<K> && sizeof(K) == 4 && B % 4 == 0) {
+        auto target = _mm_set1_epi32(static_cast<int32_t>(key));
+        for (int i = 0; i < B; i += 4) {
+            auto block = _mm_load_si128(reinterpret_cast<const __m128i *>(keys + i));
+            auto gt = _mm_cmpgt_epi32(block, target);
+            greater |= static_cast<uint64_t>(_mm_movemask_ps(_mm_castsi128_ps(gt))) << i;
+        }
+    } else
+#endif
+    {
+        // portable fallback, branch free so the compiler can vectorize it
+        for (int i = 0; i < B; ++i) {
+            greater |= static_cast<uint64_t>(keys[i] > key) << i;
+        }
+    }
+    uint64_t valid = count == 64 ? ~uint64_t{0} : (uint64_t{1} << count) - 1;
+    return __builtin_popcountll(~greater & valid);
+}
+
+}  // namespace wide
+
+/**
+ * A B-skiplist for integer keys: every level is a doubly linked list of
+ * nodes holding up to B sorted keys in one aligned block, so a lookup costs
+ * a few block compares per level instead of one pointer chase per key.
+ *
+ * A key promoted to level h starts a node on each of the levels below h,
+ * and the upper-level entry points at that node. Nodes that overflow are
+ * split in half and the new half is reached horizontally; nodes that are no
+ * longer pointed at from above are merged into their predecessor when they
+ * fit. The head of every level covers -oo and is never removed.
+ */
+template <typename K, typename V, int B=16>
+class WideSkipList {
+    static_assert(std::is_integral_v<K>, "wide nodes compare integer keys");
+    static_assert(B >= 4 && B <= 64 && B % 4 == 0, "B must be a multiple of 4 in [4, 64]");
+
+    static constexpr int kMaxLevels = 12;
+
+    struct Node {
+        alignas(64) K keys[B] {};
+        int count {0};
+        bool promoted {false};  // keys[0] is referenced from the level above
+        Node *prev {nullptr};
+        Node *next {nullptr};
+    };
+
+    struct Leaf : Node {
+        V values[B] {};
+    };
+
+    struct Inner : Node {
+        Node *children[B] {};
+    };
+
+public:
+    WideSkipList() {
+        heads_.push_back(new Leaf);
+    }
+
+    ~WideSkipList() {
+        for (int level = 0; level < static_cast<int>(heads_.size()); ++level) {
+            auto node = heads_[level];
+            while (node != nullptr) {
+                auto next = node->next;
+                FreeNode(node, level);
+                node = next;
+            }
+        }
+    }
+
+    WideSkipList(const WideSkipList &) = delete;
+    WideSkipList &operator=(const WideSkipList &) = delete;
+
+    auto Size() const -> int {
+        return curr_size_;
+    }
+
+    auto Height() const -> int {
+        return heads_.size();
+    }
+
+    auto Get(K key) -> std::optional<V> {
+        std::shared_lock<std::shared_mutex> lk{mutex_};
+        auto leaf = static_cast<Leaf *>(Descend(key, nullptr));
+        int pos = Rank(leaf, key) - 1;
+        if (pos >= 0 && leaf->keys[pos] == key) {
+            return leaf->values[pos];
+        }
+        return std::nullopt;
+    }
+
+    auto Insert(K key, V value) -> bool {
+        std::unique_lock<std::shared_mutex> lk{mutex_};
+        Node *path[kMaxLevels];
+        auto leaf = static_cast<Leaf *>(Descend(key, path));
+        int rank = Rank(leaf, key);
+        if (rank > 0 && leaf->keys[rank - 1] == key) {
+            leaf->values[rank - 1] = value;
+            return false;
+        }
+
+        int height = RandomHeight();
+        while (static_cast<int>(heads_.size()) <= height) {
+            auto head = new Inner;
+            path[heads_.size()] = head;
+            heads_.push_back(head);
+        }
+
+        // bottom up: below `height` the key starts a fresh node that the
+        // entry one level up will point at
+        Node *below = nullptr;
+        for (int level = 0; level <= height; ++level) {
+            auto node = path[level];
+            int pos = Rank(node, key);
+            if (level < height) {
+                node = SplitAt(node, pos, level);
+                pos = 0;
+                node->promoted = true;
+            }
+            auto placed = InsertAt(node, pos, key, level);
+            if (level == 0) {
+                static_cast<Leaf *>(placed.first)->values[placed.second] = value;
+            } else {
+                static_cast<Inner *>(placed.first)->children[placed.second] = below;
+            }
+            below = placed.first;
+        }
+        curr_size_ += 1;
+        return true;
+    }
+
+    auto Remove(K key) -> bool {
+        std::unique_lock<std::shared_mutex> lk{mutex_};
+        Node *path[kMaxLevels];
+        auto leaf = Descend(key, path);
+        int rank = Rank(leaf, key);
+        if (rank == 0 || leaf->keys[rank - 1] != key) {
+            return false;
+        }
+
+        // top down, so a child is unpinned before its own level is fixed up
+        for (int level = static_cast<int>(heads_.size()) - 1; level >= 0; --level) {
+            auto node = path[level];
+            int pos = Rank(node, key) - 1;
+            if (pos < 0 || node->keys[pos] != key) {
+                continue;
+            }
+            if (level > 0) {
+                static_cast<Inner *>(node)->children[pos]->promoted = false;
+            }
+            EraseAt(node, pos, level);
+            Compact(node, level);
+        }
+        while (heads_.size() > 1 && heads_.back()->count == 0 && heads_.back()->next == nullptr) {
+            FreeNode(heads_.back(), heads_.size() - 1);
+            heads_.pop_back();
+        }
+        curr_size_ -= 1;
+        return true;
+    }
+
+private:
+    static auto Rank(const Node *node, K key) -> int {
+        return wide::Rank<K, B>(node->keys, node->count, key);
+    }
+
+    /**
+     * @brief walk down to the level-0 node covering `key`, recording the
+     *        node visited on every level in `path` when given
+     */
+    auto Descend(K key, Node **path) -> Node * {
+        int level = heads_.size() - 1;
+        auto curr = heads_[level];
+        while (true) {
+            while (curr->next != nullptr && curr->next->keys[0] <= key) {
+                curr = curr->next;
+            }
+            if (path != nullptr) {
+                path[level] = curr;
+            }
+            if (level == 0) {
+                return curr;
+            }
+            // only a head can lack a key <= key, and it hangs above the next head
+            int pos = Rank(curr, key) - 1;
+            curr = pos >= 0 ? static_cast<Inner *>(curr)->children[pos] : heads_[level - 1];
+            level -= 1;
+        }
+    }
+
+    auto RandomHeight() -> int {
+        // one key in B/2 is promoted, keeping nodes about half full
+        int height = 0;
+        while (height + 1 < kMaxLevels && rand() % (B / 2) == 0) {
+            height += 1;
+        }
+        return height;
+    }
+
+    auto NewNode(int level) -> Node * {
+        return level == 0 ? static_cast<Node *>(new Leaf) : static_cast<Node *>(new Inner);
+    }
+
+    void FreeNode(Node *node, int level) {
+        if (level == 0) {
+            delete static_cast<Leaf *>(node);
+        } else {
+            delete static_cast<Inner *>(node);
+        }
+    }
+
+    /**
+     * @brief move entries [from, to) of `src` to `dst` starting at `at`
+     */
+    void MoveEntries(Node *src, int from, int to, Node *dst, int at, int level) {
+        int n = to - from;
+        std::memmove(dst->keys + at, src->keys + from, n * sizeof(K));
+        if (level == 0) {
+            auto s = static_cast<Leaf *>(src), d = static_cast<Leaf *>(dst);
+            if (s == d && at > from) {
+                // shifting right inside one node, copy from the back
+                for (int i = n - 1; i >= 0; --i) {
+                    d->values[at + i] = std::move(s->values[from + i]);
+                }
+            } else {
+                for (int i = 0; i < n; ++i) {
+                    d->values[at + i] = std::move(s->values[from + i]);
+                }
+            }
+        } else {
+            std::memmove(static_cast<Inner *>(dst)->children + at, static_cast<Inner *>(src)->children + from,
+                         n * sizeof(Node *));
+        }
+    }
+
+    void LinkAfter(Node *node, Node *fresh) {
+        fresh->prev = node;
+        fresh->next = node->next;
+        if (node->next != nullptr) {
+            node->next->prev = fresh;
+        }
+        node->next = fresh;
+    }
+
+    void Unlink(Node *node, int level) {
+        node->prev->next = node->next;
+        if (node->next != nullptr) {
+            node->next->prev = node->prev;
+        }
+        FreeNode(node, level);
+    }
+
+    /**
+     * @brief move entries [pos, count) of `node` into a new node linked right after it
+     */
+    auto SplitAt(Node *node, int pos, int level) -> Node * {
+        auto fresh = NewNode(level);
+        MoveEntries(node, pos, node->count, fresh, 0, level);
+        fresh->count = node->count - pos;
+        node->count = pos;
+        LinkAfter(node, fresh);
+        return fresh;
+    }
+
+    /**
+     * @brief open slot `pos` for `key`, splitting a full node in half first
+     * @return the node and slot the key ended up in
+     */
+    auto InsertAt(Node *node, int pos, K key, int level) -> std::pair<Node *, int> {
+        if (node->count == B) {
+            auto upper = SplitAt(node, B / 2, level);
+            if (pos > B / 2) {
+                node = upper;
+                pos -= B / 2;
+            }
+        }
+        MoveEntries(node, pos, node->count, node, pos + 1, level);
+        node->keys[pos] = key;
+        node->count += 1;
+        return {node, pos};
+    }
+
+    void EraseAt(Node *node, int pos, int level) {
+        MoveEntries(node, pos + 1, node->count, node, pos, level);
+        node->count -= 1;
+    }
+
+    /**
+     * @brief drop or merge a node that nothing above points at any more
+     */
+    void Compact(Node *node, int level) {
+        if (node == heads_[level] || node->promoted) {
+            return;
+        }
+        if (node->count == 0) {
+            Unlink(node, level);
+            return;
+        }
+        auto prev = node->prev;
+        if (prev->count + node->count <= B) {
+            MoveEntries(node, 0, node->count, prev, prev->count, level);
+            prev->count += node->count;
+            Unlink(node, level);
+        }
+    }
+
+private:
+    std::vector<Node *> heads_;
+    int curr_size_ {0};
+    std::shared_mutex mutex_;
+};
+
+}  // namespace kvstore
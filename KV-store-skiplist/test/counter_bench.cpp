@@ -0,0 +1,80 @@
+#include <assert.h>
+
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "../src/sharded_counter.h"
+
+/**
+ * @brief increments per second when `threads` threads each call `inc`
+ *        for `millis` milliseconds
+ */
+template <typename F>
+long benchIncrements(int threads, long millis, F inc) {
+  std::atomic<bool> stop{false};
+  std::atomic<int> ready{0};
+  std::vector<long> done(threads);
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t] {
+      ready.fetch_add(1);
+      while (ready.load() < threads) {
+      }
+      long n = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        // amortize the stop check
+        for (int i = 0; i < 64; ++i) {
+          inc();
+        }
+        n += 64;
+      }
+      done[t] = n;
+    });
+  }
+  while (ready.load() < threads) {
+    std::this_thread::yield();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(millis));
+  stop.store(true);
+  long total = 0;
+  for (int t = 0; t < threads; ++t) {
+    workers[t].join();
+    total += done[t];
+  }
+  return total * 1000 / millis;
+}
+
+int main(int argc, const char *argv[]) {
+  // usage: ./counter_bench [max threads] [millis per run]
+  assert(argc == 3 && "usage: ./counter_bench [max threads] [millis per run]");
+  int max_threads = static_cast<int>(strtol(argv[1], nullptr, 10));
+  long millis = strtol(argv[2], nullptr, 10);
+
+  std::cout << "--------Bench Spec--------" << std::endl;
+  std::cout << "1.." << max_threads << " threads, " << millis
+            << " ms per run, " << kvstore::details::DefaultShards()
+            << " shards" << std::endl;
+  std::cout << "---------------------------" << std::endl;
+  std::cout << std::setw(8) << "threads" << std::setw(16) << "atomic inc/s"
+            << std::setw(16) << "sharded inc/s" << std::endl;
+
+  for (int threads = 1;; threads = std::min(threads * 2, max_threads)) {
+    std::atomic<int64_t> single{0};
+    kvstore::ShardedCounter sharded;
+    auto atomic_rate = benchIncrements(threads, millis, [&] {
+      single.fetch_add(1, std::memory_order_relaxed);
+    });
+    auto sharded_rate = benchIncrements(threads, millis, [&] { sharded.Add(); });
+    std::cout << std::setw(8) << threads << std::setw(16) << atomic_rate
+              << std::setw(16) << sharded_rate << std::endl;
+    assert(sharded.Read() > 0);
+    if (threads == max_threads) {
+      break;
+    }
+  }
+  return 0;
+}
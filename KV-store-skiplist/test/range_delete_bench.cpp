@@ -0,0 +1,55 @@
+#include <assert.h>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+#include "../src/skiplist.h"
+
+/**
+ * @brief fill a list with [0, test_load) and time removing the middle `span`
+ *        keys either one by one or with a single RemoveRange
+ */
+double removeSpan(long test_load, long span, bool ranged) {
+  kvstore::SkipList<int, int> list;
+  for (long i = 0; i < test_load; i++) {
+    list.Insert(i, i);
+  }
+  long lo = (test_load - span) / 2;
+  auto start = std::chrono::high_resolution_clock::now();
+  if (ranged) {
+    list.RemoveRange(lo, lo + span);
+  } else {
+    for (long i = lo; i < lo + span; i++) {
+      list.Remove(i);
+    }
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  assert(list.Size() == test_load - span);
+  std::chrono::duration<double> elapsed = end - start;
+  return elapsed.count();
+}
+
+int main(int argc, const char *argv[]) {
+  // usage: ./range_delete_bench [number of keys] [number of keys to delete]
+  assert(argc == 3 &&
+         "usage: ./range_delete_bench [number of keys] [number of keys to "
+         "delete]");
+  long test_load = strtol(argv[1], nullptr, 10);
+  long span = strtol(argv[2], nullptr, 10);
+  assert(span <= test_load);
+
+  std::cout << "--------Bench Spec--------" << std::endl;
+  std::cout << "Delete " << span << " contiguous keys out of " << test_load
+            << std::endl;
+  std::cout << "---------------------------" << std::endl;
+
+  double per_key = removeSpan(test_load, span, false);
+  double ranged = removeSpan(test_load, span, true);
+  std::cout << "Remove per key takes  " << std::setw(10) << per_key << "s"
+            << std::endl;
+  std::cout << "RemoveRange takes     " << std::setw(10) << ranged << "s"
+            << std::endl;
+  std::cout << "Speedup is " << per_key / ranged << "x" << std::endl;
+  return 0;
+}
@@ -0,0 +1,125 @@
+#include <assert.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "../src/replication.h"
+
+/**
+ * @brief insert `test_load` keys into `list` and return the throughput
+ */
+double insertLoad(kvstore::SkipList<int, int> &list, long test_load) {
+  auto start = std::chrono::high_resolution_clock::now();
+  for (long i = 0; i < test_load; i++) {
+    list.Insert(i, i);
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> elapsed = end - start;
+  return static_cast<double>(test_load) / elapsed.count();
+}
+
+/**
+ * @brief the follower process: replicate until the primary hangs up, then
+ *        report what was applied
+ */
+int runFollower(const kvstore::Endpoint &ep) {
+  kvstore::ReplicationFollower<int, int> follower;
+  // the primary may not be listening yet
+  while (!follower.Connect(ep)) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  while (follower.Connected()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  std::cout << "Follower applied up to seq " << follower.AppliedSeq()
+            << ", holding " << follower.Size() << " keys" << std::endl;
+  return 0;
+}
+
+int main(int argc, const char *argv[]) {
+  // usage: ./replication_bench [number of test load] [unix|tcp] [batch size]
+  assert(argc == 4 &&
+         "usage: ./replication_bench [number of test load] [unix|tcp] "
+         "[batch size]");
+  long test_load = strtol(argv[1], nullptr, 10);
+  std::string transport = argv[2];
+  long batch = strtol(argv[3], nullptr, 10);
+
+  auto ep = transport == "tcp"
+                ? kvstore::Endpoint::Tcp(static_cast<uint16_t>(20000 + getpid() % 10000))
+                : kvstore::Endpoint::Unix("/tmp/kvstore_repl_bench_" + std::to_string(getpid()) + ".sock");
+
+  std::cout << "--------Bench Spec--------" << std::endl;
+  std::cout << "Launch replication bench of load " << test_load << std::endl;
+  std::cout << "over " << transport << " with batches of " << batch << std::endl;
+  std::cout << "---------------------------" << std::endl;
+
+  {
+    std::cout << "--------Primary Alone--------" << std::endl;
+    kvstore::SkipList<int, int> list;
+    std::cout << "Throughput is " << static_cast<long>(insertLoad(list, test_load)) << std::endl;
+  }
+
+  // fork before any thread exists, the child becomes the follower process
+  pid_t child = fork();
+  if (child == 0) {
+    return runFollower(ep);
+  }
+
+  {
+    std::cout << "--------Primary With Follower--------" << std::endl;
+    kvstore::SkipList<int, int> list;
+    kvstore::ReplicationOptions options;
+    options.max_batch = batch;
+    kvstore::ReplicationPrimary<int, int> primary(list, options);
+    if (!primary.Serve(ep)) {
+      std::cerr << "failed to listen" << std::endl;
+      kill(child, SIGKILL);
+      return 1;
+    }
+    // wait for the follower so the measurement includes shipping
+    while (!primary.HasFollower()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    std::atomic<bool> loading{true};
+    uint64_t max_lag = 0, lag_sum = 0, samples = 0;
+    std::thread sampler([&] {
+      while (loading) {
+        auto lag = primary.Lag();
+        max_lag = std::max(max_lag, lag);
+        lag_sum += lag;
+        samples += 1;
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+    });
+    double throughput = insertLoad(list, test_load);
+    loading = false;
+    sampler.join();
+
+    auto drain_start = std::chrono::high_resolution_clock::now();
+    while (primary.Lag() != 0) {
+      std::this_thread::yield();
+    }
+    std::chrono::duration<double> drain = std::chrono::high_resolution_clock::now() - drain_start;
+
+    std::cout << "Throughput is " << static_cast<long>(throughput) << std::endl;
+    std::cout << "Replication lag max " << max_lag << " entries, avg "
+              << (samples ? lag_sum / samples : 0) << " entries" << std::endl;
+    std::cout << "Last batch ship-to-apply latency "
+              << std::chrono::duration_cast<std::chrono::microseconds>(primary.LastAckLatency()).count()
+              << "us" << std::endl;
+    std::cout << "Follower drained " << std::setw(6) << drain.count() << "s after load, "
+              << primary.SnapshotsSent() << " snapshots sent" << std::endl;
+    primary.Stop();
+  }
+
+  waitpid(child, nullptr, 0);
+  return 0;
+}
@@ -0,0 +1,183 @@
+#include "../src/replication.h"
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+namespace kvstore {
+
+namespace {
+
+auto TestSocketPath() -> std::string {
+  return "/tmp/kvstore_repl_test_" + std::to_string(::getpid()) + ".sock";
+}
+
+// poll until the follower has applied everything the primary logged
+auto WaitForCatchUp(ReplicationPrimary<int, int> &primary,
+                    ReplicationFollower<int, int> &follower) -> bool {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (std::chrono::steady_clock::now() < deadline) {
+    if (follower.AppliedSeq() == primary.LastSeq() &&
+        primary.AckedSeq() == primary.LastSeq()) {
+      return true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return false;
+}
+
+}  // namespace
+
+TEST(MutationLogTest, ReadAfterAndWrap) {
+  MutationLog<int, int> log(4);
+  for (int i = 1; i <= 3; ++i) {
+    log.Append(LogOp::Put, i, i * 10, i);
+  }
+  EXPECT_EQ(log.LastSeq(), 3);
+
+  std::vector<LogEntry<int, int>> out;
+  EXPECT_TRUE(log.ReadAfter(1, 16, out));
+  ASSERT_EQ(out.size(), 2);
+  EXPECT_EQ(out[0].seq, 2);
+  EXPECT_EQ(out[0].key, 2);
+  EXPECT_EQ(out[1].value, 30);
+
+  // seq 1 and 2 get overwritten once the ring wraps
+  log.Append(LogOp::Remove, 1, 0, 1);
+  log.Append(LogOp::Put, 5, 50, 5);
+  log.Append(LogOp::Put, 6, 60, 6);
+  EXPECT_FALSE(log.ReadAfter(0, 16, out));
+  EXPECT_FALSE(log.ReadAfter(1, 16, out));
+  EXPECT_TRUE(log.ReadAfter(2, 16, out));
+  ASSERT_EQ(out.size(), 4);
+  EXPECT_EQ(out[1].op, LogOp::Remove);
+  EXPECT_EQ(out[3].seq, 6);
+}
+
+TEST(ReplicationTest, StreamsMutationsToFollower) {
+  SkipList<int, int> list;
+  ReplicationPrimary<int, int> primary(list);
+  auto ep = Endpoint::Unix(TestSocketPath());
+  ASSERT_TRUE(primary.Serve(ep));
+
+  ReplicationFollower<int, int> follower;
+  ASSERT_TRUE(follower.Connect(ep));
+
+  for (int i = 0; i < 2000; ++i) {
+    list.Insert(i, i);
+  }
+  for (int i = 0; i < 2000; i += 2) {
+    list.Remove(i);
+  }
+  list.Insert(1, 100);
+
+  ASSERT_TRUE(WaitForCatchUp(primary, follower));
+  EXPECT_EQ(follower.Size(), 1000);
+  EXPECT_EQ(follower.Get(1), 100);
+  EXPECT_EQ(follower.Get(3), 3);
+  EXPECT_EQ(follower.Get(4), std::nullopt);
+  EXPECT_EQ(primary.SnapshotsSent(), 0);
+
+  // a range delete ships as a single tombstone entry
+  auto before = primary.LastSeq();
+  EXPECT_EQ(list.RemoveRange(100, 200), 50);
+  EXPECT_EQ(primary.LastSeq(), before + 1);
+  ASSERT_TRUE(WaitForCatchUp(primary, follower));
+  EXPECT_EQ(follower.Size(), 950);
+  EXPECT_EQ(follower.Get(101), std::nullopt);
+  EXPECT_EQ(follower.Get(201), 201);
+}
+
+TEST(ReplicationTest, LaggingFollowerCatchesUpFromSnapshot) {
+  SkipList<int, int> list;
+  ReplicationOptions options;
+  options.log_capacity = 16;
+  ReplicationPrimary<int, int> primary(list, options);
+  auto ep = Endpoint::Unix(TestSocketPath());
+  ASSERT_TRUE(primary.Serve(ep));
+
+  // far more mutations than the log retains before the follower shows up
+  for (int i = 0; i < 500; ++i) {
+    list.Insert(i, -i);
+  }
+
+  ReplicationFollower<int, int> follower;
+  ASSERT_TRUE(follower.Connect(ep));
+  ASSERT_TRUE(WaitForCatchUp(primary, follower));
+  EXPECT_GE(primary.SnapshotsSent(), 1);
+  EXPECT_EQ(follower.Size(), 500);
+  EXPECT_EQ(follower.Get(499), -499);
+
+  // streaming resumes after the snapshot
+  list.Insert(1000, 1);
+  list.Remove(0);
+  ASSERT_TRUE(WaitForCatchUp(primary, follower));
+  EXPECT_EQ(follower.Get(1000), 1);
+  EXPECT_EQ(follower.Get(0), std::nullopt);
+}
+
+TEST(ReplicationTest, SnapshotCopiedInChunksWhileWritersRun) {
+  SkipList<int, int> list;
+  ReplicationOptions options;
+  options.log_capacity = 4096;
+  options.snapshot_chunk = 64;
+  ReplicationPrimary<int, int> primary(list, options);
+  auto ep = Endpoint::Unix(TestSocketPath());
+  ASSERT_TRUE(primary.Serve(ep));
+  for (int i = 0; i < 5000; ++i) {
+    list.Insert(i, i);
+  }
+  std::atomic<bool> stop {false};
+  std::thread writer([&] {
+    for (int i = 0; !stop.load(); ++i) {
+      list.Insert(i % 6000, -i);
+      list.Remove((i * 7) % 6000);
+    }
+  });
+  ReplicationFollower<int, int> follower;
+  ASSERT_TRUE(follower.Connect(ep));
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  stop = true;
+  writer.join();
+  ASSERT_TRUE(WaitForCatchUp(primary, follower));
+  EXPECT_GE(primary.SnapshotsSent(), 1);
+  EXPECT_EQ(follower.Size(), list.Size());
+  list.ForEach([&](const int &key, const int &value) { EXPECT_EQ(follower.Get(key), value); });
+}
+
+TEST(ReplicationTest, ResyncsAfterPrimaryRestart) {
+  auto ep = Endpoint::Unix(TestSocketPath());
+  ReplicationFollower<int, int> follower;
+  {
+    SkipList<int, int> list;
+    ReplicationPrimary<int, int> primary(list);
+    ASSERT_TRUE(primary.Serve(ep));
+    ASSERT_TRUE(follower.Connect(ep));
+    for (int i = 0; i < 100; ++i) {
+      list.Insert(i, i);
+    }
+    ASSERT_TRUE(WaitForCatchUp(primary, follower));
+    follower.Stop();
+  }
+
+  // a new incarnation logs more than the follower applied before it returns
+  SkipList<int, int> list;
+  ReplicationPrimary<int, int> primary(list);
+  ASSERT_TRUE(primary.Serve(ep));
+  for (int i = 0; i < 150; ++i) {
+    list.Insert(1000 + i, i);
+  }
+  ASSERT_TRUE(follower.Connect(ep));
+  ASSERT_TRUE(WaitForCatchUp(primary, follower));
+  EXPECT_GE(primary.SnapshotsSent(), 1);
+  EXPECT_EQ(follower.Size(), 150);
+  EXPECT_EQ(follower.Get(5), std::nullopt);
+  EXPECT_EQ(follower.Get(1149), 149);
+}
+
+}  // namespace kvstore
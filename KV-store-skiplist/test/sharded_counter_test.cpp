@@ -0,0 +1,73 @@
+#include "../src/sharded_counter.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+namespace kvstore {
+
+TEST(ShardedCounterTest, AddSubRead) {
+  ShardedCounter counter(4);
+  EXPECT_EQ(counter.Shards(), 4u);
+  EXPECT_EQ(counter.Read(), 0);
+  counter.Add();
+  counter.Add(10);
+  counter.Sub(3);
+  EXPECT_EQ(counter.Read(), 8);
+  counter.Reset();
+  EXPECT_EQ(counter.Read(), 0);
+}
+
+TEST(ShardedCounterTest, RoundsShardsUpToAPowerOfTwo) {
+  ShardedCounter none(0);
+  EXPECT_EQ(none.Shards(), 1u);
+  none.Add(7);
+  EXPECT_EQ(none.Read(), 7);
+
+  ShardedCounter odd(5);
+  EXPECT_EQ(odd.Shards(), 8u);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 12; ++t) {
+    threads.emplace_back([&odd] { odd.Add(); });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(odd.Read(), 12);
+}
+
+TEST(ShardedCounterTest, ConcurrentAddsAreExactOnceJoined) {
+  ShardedCounter counter;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&counter, t] {
+      for (int i = 0; i < 100000; ++i) {
+        // half the threads count down, so cells go negative on their own
+        counter.Add(t % 2 == 0 ? 3 : -1);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(counter.Read(), 4 * 100000 * 3 - 4 * 100000);
+}
+
+TEST(CounterRegistryTest, NamesMapToOneCounter) {
+  CounterRegistry registry;
+  auto &hits = registry.Counter("hits");
+  hits.Add(5);
+  EXPECT_EQ(&registry.Counter("hits"), &hits);
+  registry.Counter("misses").Add(2);
+
+  auto snapshot = registry.Snapshot();
+  ASSERT_EQ(snapshot.size(), 2u);
+  EXPECT_EQ(snapshot[0], std::make_pair(std::string("hits"), int64_t{5}));
+  EXPECT_EQ(snapshot[1], std::make_pair(std::string("misses"), int64_t{2}));
+
+  registry.Reset();
+  EXPECT_EQ(registry.Counter("hits").Read(), 0);
+}
+
+}  // namespace kvstore
@@ -0,0 +1,152 @@
+#include <assert.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../src/skiplist.h"
+#include "../src/wide_skiplist.h"
+
+/**
+ * @brief a hardware counter of the calling thread, -1 when perf events are
+ *        not available (e.g. inside containers)
+ */
+class PerfCounter {
+ public:
+  PerfCounter(uint32_t type, uint64_t config) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd_ = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+  }
+  ~PerfCounter() {
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+  }
+  void Start() {
+    if (fd_ >= 0) {
+      ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+  long Stop() {
+    long long count = -1;
+    if (fd_ >= 0) {
+      ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+      if (read(fd_, &count, sizeof(count)) != sizeof(count)) {
+        count = -1;
+      }
+    }
+    return count;
+  }
+
+ private:
+  int fd_;
+};
+
+void report(const char *name, double seconds, long lookups, long l1_misses,
+            long llc_misses) {
+  std::cout << std::left << std::setw(14) << name << std::right
+            << " lookups/s " << std::setw(10)
+            << static_cast<long>(lookups / seconds);
+  auto per_lookup = [&](long misses) {
+    if (misses < 0) {
+      std::cout << "n/a";
+    } else {
+      std::cout << static_cast<double>(misses) / lookups;
+    }
+  };
+  std::cout << "  L1d misses/lookup ";
+  per_lookup(l1_misses);
+  std::cout << "  LLC misses/lookup ";
+  per_lookup(llc_misses);
+  std::cout << std::endl;
+}
+
+/**
+ * @brief time `lookups` random point lookups done by `lookup`
+ */
+template <typename F>
+void benchLookups(const char *name, const std::vector<int> &probes, F lookup) {
+  PerfCounter l1(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                                          (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+  PerfCounter llc(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+  long found = 0;
+  l1.Start();
+  llc.Start();
+  auto start = std::chrono::high_resolution_clock::now();
+  for (auto key : probes) {
+    found += lookup(key);
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  long l1_misses = l1.Stop();
+  long llc_misses = llc.Stop();
+  std::chrono::duration<double> elapsed = end - start;
+  assert(found == static_cast<long>(probes.size()));
+  report(name, elapsed.count(), probes.size(), l1_misses, llc_misses);
+}
+
+int main(int argc, const char *argv[]) {
+  // usage: ./skiplist_bench [number of keys] [number of lookups]
+  assert(argc == 3 &&
+         "usage: ./skiplist_bench [number of keys] [number of lookups]");
+  long num_keys = strtol(argv[1], nullptr, 10);
+  long num_lookups = strtol(argv[2], nullptr, 10);
+
+  std::vector<int> keys(num_keys);
+  for (long i = 0; i < num_keys; i++) {
+    keys[i] = static_cast<int>(i * 7);
+  }
+  std::mt19937 rng(42);
+  std::shuffle(keys.begin(), keys.end(), rng);
+  std::vector<int> probes(num_lookups);
+  for (auto &probe : probes) {
+    probe = keys[rng() % num_keys];
+  }
+
+  std::cout << "--------Bench Spec--------" << std::endl;
+  std::cout << num_keys << " random int keys, " << num_lookups
+            << " random lookups" << std::endl;
+  std::cout << "---------------------------" << std::endl;
+
+  kvstore::SkipList<int, int> list;
+  kvstore::WideSkipList<int, int> wide;
+
+  auto start = std::chrono::high_resolution_clock::now();
+  for (auto key : keys) {
+    list.Insert(key, key);
+  }
+  std::chrono::duration<double> list_insert =
+      std::chrono::high_resolution_clock::now() - start;
+  start = std::chrono::high_resolution_clock::now();
+  for (auto key : keys) {
+    wide.Insert(key, key);
+  }
+  std::chrono::duration<double> wide_insert =
+      std::chrono::high_resolution_clock::now() - start;
+  std::cout << "SkipList       inserts/s " << std::setw(10)
+            << static_cast<long>(num_keys / list_insert.count()) << std::endl;
+  std::cout << "WideSkipList   inserts/s " << std::setw(10)
+            << static_cast<long>(num_keys / wide_insert.count()) << std::endl;
+
+  benchLookups("SkipList", probes,
+               [&](int key) { return list.Search(key)->Key() == key; });
+  benchLookups("WideSkipList", probes,
+               [&](int key) { return wide.Get(key).has_value(); });
+  return 0;
+}
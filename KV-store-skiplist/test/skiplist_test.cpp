@@ -2,7 +2,10 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <thread>
 #include <type_traits>
+#include <vector>
 
 namespace kvstore {
 
@@ -242,4 +245,152 @@ TEST(SkipListTest, SKipListRemoveTest) {
   EXPECT_EQ(skip.Remove(5), false);
   EXPECT_NE(skip.Search(5)->Key(), 5);
 }
+
+TEST(SkipListTest, SkipListRemoveRangeTest) {
+  SkipList<int, int> skip;
+  for (int i = 0; i < 100; ++i) {
+    skip.Insert(i, i);
+  }
+
+  EXPECT_EQ(skip.RemoveRange(20, 20), 0);
+  EXPECT_EQ(skip.RemoveRange(30, 10), 0);
+  EXPECT_EQ(skip.RemoveRange(10, 20), 10);
+  EXPECT_EQ(skip.Size(), 90);
+  EXPECT_EQ(skip.Search(15)->Key(), 9);
+  EXPECT_EQ(skip.Search(20)->Key(), 20);
+  EXPECT_EQ(skip.Remove(10), false);
+
+  // bounds need not exist, and the span may reach either end of the list
+  EXPECT_EQ(skip.RemoveRange(-5, 3), 3);
+  EXPECT_EQ(skip.RemoveRange(95, 1000), 5);
+  EXPECT_EQ(skip.Size(), 82);
+  EXPECT_TRUE(skip.Search(2)->IsSentinel());
+  EXPECT_EQ(skip.Search(1000)->Key(), 94);
+
+  // the unlinked span can be refilled
+  for (int i = 10; i < 20; ++i) {
+    EXPECT_TRUE(skip.Insert(i, -i));
+  }
+  EXPECT_EQ(skip.Search(15)->Value(), -15);
+  EXPECT_EQ(skip.Size(), 92);
+
+  EXPECT_EQ(skip.RemoveRange(0, 1000), 92);
+  EXPECT_EQ(skip.Size(), 0);
+  EXPECT_TRUE(skip.Search(50)->IsSentinel());
+}
+
+TEST(SkipListTest, SizeUnderConcurrentWriters) {
+  SkipList<int, int> list;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&list, t] {
+      for (int i = 0; i < 1000; ++i) {
+        list.Insert(t * 1000 + i, i);
+      }
+      for (int i = 0; i < 1000; i += 2) {
+        list.Remove(t * 1000 + i);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(list.Size(), 2000);
+}
+
+TEST(SpaceSavingTest, TracksHeavyHitters) {
+  SpaceSaving<int> sketch(4);
+  for (int round = 0; round < 100; ++round) {
+    sketch.Offer(7);
+    sketch.Offer(7);
+    sketch.Offer(round + 100);  // a long tail of cold keys
+  }
+  auto counters = sketch.Counters();
+  EXPECT_EQ(counters.size(), 4);
+  auto hot = std::find_if(counters.begin(), counters.end(),
+                          [](const auto &c) { return c.key == 7; });
+  ASSERT_NE(hot, counters.end());
+  // space-saving never under-estimates, and over-estimates by at most `error`
+  EXPECT_GE(hot->count, 200);
+  EXPECT_LE(hot->count - hot->error, 200);
+}
+
+#if KVSTORE_ENABLE_STATS
+TEST(SkipListStatsTest, CountsOperationsAndSearchCost) {
+  SkipList<int, int> skip;
+  for (int i = 0; i < 100; ++i) {
+    skip.Insert(i, i);
+  }
+  skip.Insert(3, 30);
+  skip.Remove(4);
+  skip.Remove(1000);
+  for (int i = 0; i < 1000; ++i) {
+    skip.Search(42);
+  }
+
+  auto stats = skip.Stats();
+  EXPECT_EQ(stats.inserts, 100);
+  EXPECT_EQ(stats.updates, 1);
+  EXPECT_EQ(stats.removes, 1);
+  EXPECT_EQ(stats.remove_misses, 1);
+  EXPECT_EQ(stats.searches, 1000);
+  EXPECT_GE(stats.descents, 1103);
+  EXPECT_EQ(stats.lock_acquisitions, 103);
+  EXPECT_GE(stats.LevelsPerSearch(), 1.0);
+  EXPECT_GE(stats.ComparisonsPerSearch(), stats.LevelsPerSearch());
+  ASSERT_FALSE(stats.hot_keys.empty());
+  EXPECT_EQ(stats.hot_keys.front().first, 42);
+}
+
+TEST(SkipListStatsTest, AggregatesAcrossThreads) {
+  SkipList<int, int> skip;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&skip, t] {
+      for (int i = 0; i < 250; ++i) {
+        skip.Insert(t * 1000 + i, i);
+      }
+    });
+  }
+  for (auto &thr : threads) {
+    thr.join();
+  }
+  auto stats = skip.Stats();
+  EXPECT_EQ(stats.inserts, 1000);
+  EXPECT_LE(stats.threads, 4);
+  EXPECT_EQ(stats.lock_acquisitions, 1000);
+  EXPECT_LE(stats.lock_contended, stats.lock_acquisitions);
+}
+
+TEST(SkipListStatsTest, OneCellPerThreadAcrossManyLists) {
+  // one thread cycling through many lists
+  std::vector<SkipList<int, int>> skips(20);
+  for (int round = 0; round < 50; ++round) {
+    for (auto &skip : skips) {
+      skip.Insert(round, round);
+    }
+  }
+  for (auto &skip : skips) {
+    auto stats = skip.Stats();
+    EXPECT_EQ(stats.inserts, 50);
+    EXPECT_EQ(stats.threads, 1);
+  }
+}
+
+TEST(SkipListStatsTest, ExitedThreadsHandOverTheirCells) {
+  SkipList<int, int> skip;
+  for (int wave = 0; wave < 10; ++wave) {
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back([&skip, wave, t] { skip.Insert(wave * 10 + t, t); });
+    }
+    for (auto &thr : threads) {
+      thr.join();
+    }
+  }
+  auto stats = skip.Stats();
+  EXPECT_EQ(stats.inserts, 40);
+  EXPECT_LE(stats.threads, 4);
+}
+#endif
 }  // namespace kvstore
\ No newline at end of file
@@ -69,5 +69,10 @@ int main(int argc, const char *argv[]) {
               << std::endl;
   }
 
+#if KVSTORE_ENABLE_STATS
+  std::cout << "--------Stats--------" << std::endl;
+  std::cout << test_list.Stats();
+#endif
+
   return 0;
 }
\ No newline at end of file
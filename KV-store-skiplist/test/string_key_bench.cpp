@@ -0,0 +1,98 @@
+#include <assert.h>
+#include <malloc.h>
+
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/skiplist.h"
+#include "../src/string_skiplist.h"
+
+/**
+ * @brief bytes currently allocated from the heap
+ */
+size_t heapInUse() { return mallinfo2().uordblks; }
+
+/**
+ * @brief load `keys` into `list` and time random lookups, reporting heap
+ *        growth per key and lookup throughput
+ */
+template <typename List, typename Insert, typename Lookup>
+void bench(const char *name, const std::vector<std::string> &keys,
+           const std::vector<size_t> &probes, Insert insert, Lookup lookup) {
+  size_t before = heapInUse();
+  auto list = new List;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < keys.size(); i++) {
+    insert(*list, keys[i], static_cast<int>(i));
+  }
+  std::chrono::duration<double> inserted =
+      std::chrono::high_resolution_clock::now() - start;
+  size_t heap = heapInUse() - before;
+
+  long found = 0;
+  start = std::chrono::high_resolution_clock::now();
+  for (auto i : probes) {
+    found += lookup(*list, keys[i]);
+  }
+  std::chrono::duration<double> looked_up =
+      std::chrono::high_resolution_clock::now() - start;
+  assert(found == static_cast<long>(probes.size()));
+
+  std::cout << std::left << std::setw(16) << name << std::right
+            << " heap bytes/key " << std::setw(6) << heap / keys.size()
+            << "  inserts/s " << std::setw(9)
+            << static_cast<long>(keys.size() / inserted.count())
+            << "  lookups/s " << std::setw(9)
+            << static_cast<long>(probes.size() / looked_up.count())
+            << std::endl;
+  delete list;
+}
+
+int main(int argc, const char *argv[]) {
+  // usage: ./string_key_bench [number of keys] [number of lookups]
+  assert(argc == 3 &&
+         "usage: ./string_key_bench [number of keys] [number of lookups]");
+  long num_keys = strtol(argv[1], nullptr, 10);
+  long num_lookups = strtol(argv[2], nullptr, 10);
+
+  // tenant/table/row ids: long keys sharing most of their bytes
+  std::vector<std::string> keys;
+  size_t raw_bytes = 0;
+  for (long i = 0; i < num_keys; i++) {
+    char buf[96];
+    snprintf(buf, sizeof(buf), "tenant-%06ld/table-customer-orders/row-%010ld",
+             i % 16, i * 7919 % 1000000007);
+    keys.emplace_back(buf);
+    raw_bytes += keys.back().size();
+  }
+  std::mt19937 rng(42);
+  std::vector<size_t> probes(num_lookups);
+  for (auto &probe : probes) {
+    probe = rng() % num_keys;
+  }
+
+  std::cout << "--------Bench Spec--------" << std::endl;
+  std::cout << num_keys << " string keys of " << raw_bytes / num_keys
+            << " bytes on average, " << num_lookups << " random lookups"
+            << std::endl;
+  std::cout << "---------------------------" << std::endl;
+
+  bench<kvstore::SkipList<std::string, int>>(
+      "SkipList", keys, probes,
+      [](auto &list, const std::string &key, int v) { list.Insert(key, v); },
+      [](auto &list, const std::string &key) {
+        return list.Search(key)->Key() == key;
+      });
+  bench<kvstore::StringSkipList<int>>(
+      "StringSkipList", keys, probes,
+      [](auto &list, const std::string &key, int v) { list.Insert(key, v); },
+      [](auto &list, const std::string &key) {
+        return list.Get(key).has_value();
+      });
+  return 0;
+}
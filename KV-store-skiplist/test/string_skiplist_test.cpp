@@ -0,0 +1,122 @@
+#include "../src/string_skiplist.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+
+namespace kvstore {
+
+TEST(StringKeyTest, PrefixOrdersLikeStrings) {
+  EXPECT_LT(strkey::Prefix("abc"), strkey::Prefix("abd"));
+  EXPECT_LT(strkey::Prefix("ab"), strkey::Prefix("abc"));
+  EXPECT_LT(strkey::Prefix(std::string("a\x01", 2)), strkey::Prefix("a\xff"));
+  // only the first 8 bytes take part, longer keys may tie
+  EXPECT_EQ(strkey::Prefix("tenant-00/x"), strkey::Prefix("tenant-00/y"));
+}
+
+TEST(StringSkipListTest, InsertGetRemove) {
+  StringSkipList<int> list;
+  EXPECT_EQ(list.Get("a"), std::nullopt);
+  EXPECT_TRUE(list.Insert("tenant/1/row/2", 2));
+  EXPECT_TRUE(list.Insert("tenant/1/row/1", 1));
+  EXPECT_TRUE(list.Insert("tenant/1", 0));
+  EXPECT_TRUE(list.Insert("", -1));
+  EXPECT_FALSE(list.Insert("tenant/1/row/2", 20));
+  EXPECT_EQ(list.Size(), 4);
+
+  EXPECT_EQ(list.Get("tenant/1/row/2"), 20);
+  EXPECT_EQ(list.Get("tenant/1"), 0);
+  EXPECT_EQ(list.Get(""), -1);
+  EXPECT_EQ(list.Get("tenant/1/row"), std::nullopt);
+  EXPECT_EQ(list.Get("tenant/1/row/3"), std::nullopt);
+
+  EXPECT_TRUE(list.Remove("tenant/1"));
+  EXPECT_FALSE(list.Remove("tenant/1"));
+  EXPECT_EQ(list.Get("tenant/1"), std::nullopt);
+  EXPECT_EQ(list.Get("tenant/1/row/1"), 1);
+  EXPECT_EQ(list.Size(), 3);
+}
+
+TEST(StringSkipListTest, RandomOpsAgainstMap) {
+  StringSkipList<int> list;
+  std::map<std::string, int> model;
+  std::mt19937 rng(7);
+  // heavily shared prefixes, keys that are prefixes of each other, odd bytes
+  auto make_key = [&] {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "tenant-%02u/table-%u/row-%u", static_cast<unsigned>(rng() % 4),
+             static_cast<unsigned>(rng() % 3), static_cast<unsigned>(rng() % 300));
+    std::string key(buf);
+    key.resize(rng() % (key.size() + 1));
+    if (rng() % 16 == 0) {
+      key.push_back(static_cast<char>(rng() % 256));
+    }
+    return key;
+  };
+  for (int i = 0; i < 30000; ++i) {
+    auto key = make_key();
+    if (rng() % 3 != 0) {
+      EXPECT_EQ(list.Insert(key, i), model.count(key) == 0);
+      model[key] = i;
+    } else {
+      EXPECT_EQ(list.Remove(key), model.erase(key) == 1);
+    }
+  }
+  EXPECT_EQ(list.Size(), static_cast<int>(model.size()));
+  for (const auto &[key, value] : model) {
+    EXPECT_EQ(list.Get(key), value);
+  }
+  for (int i = 0; i < 2000; ++i) {
+    auto key = make_key();
+    EXPECT_EQ(list.Get(key).has_value(), model.count(key) == 1);
+  }
+  for (const auto &[key, value] : model) {
+    EXPECT_TRUE(list.Remove(key));
+  }
+  EXPECT_EQ(list.Size(), 0);
+}
+
+TEST(StringSkipListTest, PrefixCompressionSavesMemory) {
+  StringSkipList<int> list;
+  size_t raw_bytes = 0;
+  for (int i = 0; i < 50000; ++i) {
+    char buf[80];
+    snprintf(buf, sizeof(buf),
+             "tenant-000042/table-customer-orders/row-%08d", i);
+    raw_bytes += strlen(buf);
+    list.Insert(buf, i);
+  }
+  // each entry keeps little more than its distinct suffix
+  EXPECT_LT(list.MemoryUsage(), raw_bytes / 2);
+}
+
+TEST(StringSkipListTest, ChurnKeepsMemoryBounded) {
+  StringSkipList<int> list;
+  std::string pad(160, 'x');
+  char buf[256];
+  auto key = [&](int round, int i) {
+    snprintf(buf, sizeof(buf), "tenant-%04d/%s/row-%06d", round, pad.c_str(), i);
+    return std::string(buf);
+  };
+  size_t first_round = 0;
+  for (int round = 0; round < 40; ++round) {
+    // fresh keys every round, so every split stores a new separator
+    for (int i = 0; i < 1000; ++i) {
+      list.Insert(key(round, i), i);
+    }
+    for (int i = 0; i < 1000; ++i) {
+      ASSERT_TRUE(list.Remove(key(round, i)));
+    }
+    if (round == 0) {
+      first_round = list.MemoryUsage();
+    }
+  }
+  EXPECT_EQ(list.Size(), 0);
+  // retired separators are reused, not appended
+  EXPECT_LE(list.MemoryUsage(), 2 * first_round);
+}
+
+}  // namespace kvstore
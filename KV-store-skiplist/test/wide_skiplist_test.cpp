@@ -0,0 +1,94 @@
+#include "../src/wide_skiplist.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <map>
+#include <random>
+
+namespace kvstore {
+
+TEST(WideRankTest, CountsKeysNotGreater) {
+  alignas(64) int32_t keys[16] = {-5, 0, 3, 3, 8, 13, 21, 34};
+  EXPECT_EQ((wide::Rank<int32_t, 16>(keys, 8, -6)), 0);
+  EXPECT_EQ((wide::Rank<int32_t, 16>(keys, 8, -5)), 1);
+  EXPECT_EQ((wide::Rank<int32_t, 16>(keys, 8, 3)), 4);
+  EXPECT_EQ((wide::Rank<int32_t, 16>(keys, 8, 100)), 8);
+  // slots past `count` never take part
+  EXPECT_EQ((wide::Rank<int32_t, 16>(keys, 3, 100)), 3);
+
+  alignas(64) int64_t wide_keys[8] = {INT64_MIN, -1, 1LL << 40, INT64_MAX};
+  EXPECT_EQ((wide::Rank<int64_t, 8>(wide_keys, 4, 0)), 2);
+  EXPECT_EQ((wide::Rank<int64_t, 8>(wide_keys, 4, INT64_MAX)), 4);
+}
+
+TEST(WideSkipListTest, InsertGetRemove) {
+  WideSkipList<int, int> list;
+  EXPECT_EQ(list.Get(1), std::nullopt);
+  EXPECT_TRUE(list.Insert(1, 12));
+  EXPECT_TRUE(list.Insert(4, 13));
+  EXPECT_TRUE(list.Insert(-2, 2));
+  EXPECT_FALSE(list.Insert(4, 9));
+  EXPECT_EQ(list.Size(), 3);
+  EXPECT_EQ(list.Get(4), 9);
+  EXPECT_EQ(list.Get(-2), 2);
+  EXPECT_EQ(list.Get(0), std::nullopt);
+
+  EXPECT_TRUE(list.Remove(4));
+  EXPECT_FALSE(list.Remove(4));
+  EXPECT_EQ(list.Get(4), std::nullopt);
+  EXPECT_EQ(list.Size(), 2);
+}
+
+// random operations checked against std::map, enough to split and merge a lot
+template <typename K, int B>
+void RandomOpsAgainstMap(uint32_t seed) {
+  WideSkipList<K, K, B> list;
+  std::map<K, K> model;
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> key_dist(-3000, 3000);
+  for (int i = 0; i < 40000; ++i) {
+    K key = static_cast<K>(key_dist(rng)) * 100003;
+    switch (rng() % 3) {
+      case 0:
+      case 1:
+        EXPECT_EQ(list.Insert(key, i), model.count(key) == 0);
+        model[key] = i;
+        break;
+      default:
+        EXPECT_EQ(list.Remove(key), model.erase(key) == 1);
+    }
+  }
+  EXPECT_EQ(list.Size(), static_cast<int>(model.size()));
+  for (int k = -3000; k <= 3000; ++k) {
+    K key = static_cast<K>(k) * 100003;
+    auto it = model.find(key);
+    auto got = list.Get(key);
+    if (it == model.end()) {
+      EXPECT_EQ(got, std::nullopt);
+    } else {
+      ASSERT_TRUE(got.has_value());
+      EXPECT_EQ(*got, it->second);
+    }
+  }
+  // draining everything collapses back to a single level
+  for (auto &[key, value] : model) {
+    EXPECT_TRUE(list.Remove(key));
+  }
+  EXPECT_EQ(list.Size(), 0);
+  EXPECT_EQ(list.Height(), 1);
+}
+
+TEST(WideSkipListTest, RandomOps32) {
+  RandomOpsAgainstMap<int32_t, 16>(1);
+}
+
+TEST(WideSkipListTest, RandomOps64) {
+  RandomOpsAgainstMap<int64_t, 8>(2);
+}
+
+TEST(WideSkipListTest, RandomOpsSmallNodes) {
+  RandomOpsAgainstMap<int32_t, 4>(3);
+}
+
+}  // namespace kvstore
@@ -0,0 +1,97 @@
+#include <assert.h>
+#include <sys/resource.h>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../src/rwlock.h"
+#include "bench_util.h"
+
+struct Spec {
+  int max_threads;
+  uint32_t write_percent;
+  uint64_t hold_ns;
+  std::chrono::milliseconds duration;
+};
+
+/**
+ * User plus system CPU time of the whole process.
+ */
+auto cpu_nanos() -> uint64_t {
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  auto ns = [](const timeval &tv) { return tv.tv_sec * 1000000000ULL + tv.tv_usec * 1000ULL; };
+  return ns(usage.ru_utime) + ns(usage.ru_stime);
+}
+
+template <typename Wait>
+void run(const char *name, int threads, const Spec &spec) {
+  bustub::BasicReaderWriterLatch<bustub::rwpolicy::WriterPreferring, Wait> latch;
+  uint64_t value = 0;
+  std::vector<std::vector<uint64_t>> waits(threads);
+
+  auto cpu_start = cpu_nanos();
+  auto wall_start = bench::NowNanos();
+  auto ops = bench::RunFor(threads, spec.duration, [&](int tid, std::atomic<bool> &stop) {
+    bench::FastRand rand(tid);
+    auto &samples = waits[tid];
+    samples.reserve(1 << 16);
+    uint64_t done = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+      auto start = bench::NowNanos();
+      if (rand.Next() % 100 < spec.write_percent) {
+        latch.WLock();
+        samples.push_back(bench::NowNanos() - start);
+        value++;
+        bench::SpinFor(spec.hold_ns);
+        latch.WUnlock();
+      } else {
+        latch.RLock();
+        samples.push_back(bench::NowNanos() - start);
+        bench::SpinFor(spec.hold_ns);
+        latch.RUnlock();
+      }
+      done++;
+    }
+    return done;
+  });
+  auto wall = bench::NowNanos() - wall_start;
+  auto cpu = cpu_nanos() - cpu_start;
+
+  bench::Latencies all;
+  for (auto &samples : waits) {
+    all.Add(samples);
+  }
+  std::cout << std::left << std::setw(10) << name << std::right << std::setw(8) << threads << std::setw(14)
+            << ops * 1000 / spec.duration.count() << std::setw(10) << all.Percentile(50) / 1000.0 << std::setw(10)
+            << all.Percentile(99) / 1000.0 << std::setw(10) << all.Percentile(99.9) / 1000.0
+            // cores kept busy, spinning shows up here rather than in throughput
+            << std::setw(10) << 100.0 * cpu / wall << std::endl;
+  assert(value <= ops && "lost write");
+}
+
+int main(int argc, char **argv) {
+  assert(argc == 5 && "usage: ./adaptive_bench <max_threads> <write_percent> <hold_ns> <millis_per_run>");
+  Spec spec{std::stoi(argv[1]), static_cast<uint32_t>(std::stoul(argv[2])), std::stoull(argv[3]),
+            std::chrono::milliseconds(std::stoi(argv[4]))};
+
+  std::cout << "--------Bench Spec--------" << std::endl;
+  std::cout << "max threads: " << spec.max_threads << std::endl;
+  std::cout << "write percent: " << spec.write_percent << std::endl;
+  std::cout << "hold ns: " << spec.hold_ns << std::endl;
+  std::cout << "millis per run: " << spec.duration.count() << std::endl;
+  std::cout << "--------------------------" << std::endl;
+
+  std::cout << std::left << std::setw(10) << "wait" << std::right << std::setw(8) << "threads" << std::setw(14)
+            << "ops/s" << std::setw(10) << "p50 us" << std::setw(10) << "p99 us" << std::setw(10) << "p99.9 us"
+            << std::setw(10) << "cpu %" << std::endl;
+  std::cout << std::fixed << std::setprecision(1);
+  for (int threads : bench::ThreadCounts(spec.max_threads)) {
+    run<bustub::waitpolicy::Block>("block", threads, spec);
+    run<bustub::waitpolicy::Adaptive>("adaptive", threads, spec);
+  }
+  return 0;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace bench {
+
+/**
+ * Run `body(tid, stop)` on `threads` threads for `duration`, every body
+ * returns how many operations it finished. Threads start together.
+ */
+template <typename Body>
+auto RunFor(int threads, std::chrono::milliseconds duration, Body body) -> uint64_t {
+  std::atomic<bool> stop{false};
+  std::atomic<int> ready{0};
+  std::vector<uint64_t> ops(threads);
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t] {
+      ready.fetch_add(1);
+      while (ready.load() < threads) {
+      }
+      ops[t] = body(t, stop);
+    });
+  }
+  while (ready.load() < threads) {
+    std::this_thread::yield();
+  }
+  std::this_thread::sleep_for(duration);
+  stop.store(true);
+  uint64_t total = 0;
+  for (int t = 0; t < threads; ++t) {
+    workers[t].join();
+    total += ops[t];
+  }
+  return total;
+}
+
+/**
+ * 1, 2, 4, ... up to and including `max`.
+ */
+inline auto ThreadCounts(int max) -> std::vector<int> {
+  std::vector<int> counts;
+  for (int n = 1; n < max; n *= 2) {
+    counts.push_back(n);
+  }
+  counts.push_back(max);
+  return counts;
+}
+
+/**
+ * Cheap per-thread generator for picking operations inside a timed loop.
+ */
+class FastRand {
+ public:
+  explicit FastRand(uint64_t seed) : state_(seed * 0x9E3779B97F4A7C15ULL + 1) {}
+  auto Next() -> uint32_t {
+    state_ ^= state_ << 13;
+    state_ ^= state_ >> 7;
+    state_ ^= state_ << 17;
+    return static_cast<uint32_t>(state_ >> 32);
+  }
+
+ private:
+  uint64_t state_;
+};
+
+/**
+ * Wait-time samples of one role, merged from all its threads.
+ */
+class Latencies {
+ public:
+  void Add(const std::vector<uint64_t> &samples) { samples_.insert(samples_.end(), samples.begin(), samples.end()); }
+
+  /**
+   * The p-th percentile (0 <= p <= 100) in nanoseconds, sorts on first use.
+   */
+  auto Percentile(double p) -> uint64_t {
+    if (samples_.empty()) {
+      return 0;
+    }
+    if (!sorted_) {
+      std::sort(samples_.begin(), samples_.end());
+      sorted_ = true;
+    }
+    auto rank = static_cast<size_t>(p / 100 * (samples_.size() - 1));
+    return samples_[rank];
+  }
+
+  auto Count() const -> size_t { return samples_.size(); }
+
+ private:
+  std::vector<uint64_t> samples_;
+  bool sorted_{false};
+};
+
+inline auto NowNanos() -> uint64_t {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+/**
+ * Busy work standing in for a critical section of about `ns` nanoseconds.
+ */
+inline void SpinFor(uint64_t ns) {
+  auto until = NowNanos() + ns;
+  while (NowNanos() < until) {
+  }
+}
+
+}  // namespace bench
@@ -0,0 +1,93 @@
+#include <assert.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../src/rwlock.h"
+#include "bench_util.h"
+
+struct Spec {
+  int readers;
+  int writers;
+  uint64_t read_hold_ns;
+  uint64_t write_hold_ns;
+  std::chrono::milliseconds duration;
+};
+
+void report_role(const char *role, bench::Latencies &waits, const std::vector<uint64_t> &ops) {
+  if (ops.empty()) {
+    return;
+  }
+  auto [min, max] = std::minmax_element(ops.begin(), ops.end());
+  std::cout << "  " << std::left << std::setw(7) << role << std::right << " acquisitions " << std::setw(9)
+            << waits.Count() << "  wait us p50 " << std::setw(8) << waits.Percentile(50) / 1000.0 << " p99 "
+            << std::setw(8) << waits.Percentile(99) / 1000.0 << " p99.9 " << std::setw(8)
+            << waits.Percentile(99.9) / 1000.0 << " max " << std::setw(9) << waits.Percentile(100) / 1000.0
+            // a thread that got far fewer turns than its peers was starved
+            << "  min/max per thread " << *min << "/" << *max << std::endl;
+}
+
+template <typename Policy>
+void run(const char *name, const Spec &spec) {
+  bustub::BasicReaderWriterLatch<Policy> latch;
+  int threads = spec.readers + spec.writers;
+  std::vector<std::vector<uint64_t>> waits(threads);
+  std::vector<uint64_t> ops(threads);
+  bench::RunFor(threads, spec.duration, [&](int tid, std::atomic<bool> &stop) {
+    bool writer = tid < spec.writers;
+    auto &samples = waits[tid];
+    samples.reserve(1 << 16);
+    while (!stop.load(std::memory_order_relaxed)) {
+      auto start = bench::NowNanos();
+      if (writer) {
+        latch.WLock();
+        samples.push_back(bench::NowNanos() - start);
+        bench::SpinFor(spec.write_hold_ns);
+        latch.WUnlock();
+      } else {
+        latch.RLock();
+        samples.push_back(bench::NowNanos() - start);
+        bench::SpinFor(spec.read_hold_ns);
+        latch.RUnlock();
+      }
+      ops[tid]++;
+    }
+    return ops[tid];
+  });
+
+  bench::Latencies reads;
+  bench::Latencies writes;
+  for (int t = 0; t < threads; ++t) {
+    (t < spec.writers ? writes : reads).Add(waits[t]);
+  }
+  std::cout << name << std::endl;
+  std::cout << std::fixed << std::setprecision(1);
+  report_role("reader", reads, std::vector<uint64_t>(ops.begin() + spec.writers, ops.end()));
+  report_role("writer", writes, std::vector<uint64_t>(ops.begin(), ops.begin() + spec.writers));
+  // empty unless built with BUSTUB_LATCH_PROFILE
+  bustub::profile::Dump(std::cout);
+  bustub::profile::Reset();
+}
+
+int main(int argc, char **argv) {
+  assert(argc == 6 && "usage: ./fairness_bench <readers> <writers> <read_hold_ns> <write_hold_ns> <millis_per_run>");
+  Spec spec{std::stoi(argv[1]), std::stoi(argv[2]), std::stoull(argv[3]), std::stoull(argv[4]),
+            std::chrono::milliseconds(std::stoi(argv[5]))};
+
+  std::cout << "--------Bench Spec--------" << std::endl;
+  std::cout << "readers: " << spec.readers << std::endl;
+  std::cout << "writers: " << spec.writers << std::endl;
+  std::cout << "read hold ns: " << spec.read_hold_ns << std::endl;
+  std::cout << "write hold ns: " << spec.write_hold_ns << std::endl;
+  std::cout << "millis per run: " << spec.duration.count() << std::endl;
+  std::cout << "--------------------------" << std::endl;
+
+  run<bustub::rwpolicy::ReaderPreferring>("reader-preferring", spec);
+  run<bustub::rwpolicy::WriterPreferring>("writer-preferring", spec);
+  run<bustub::rwpolicy::PhaseFair>("phase-fair", spec);
+  return 0;
+}
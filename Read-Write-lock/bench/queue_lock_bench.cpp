@@ -0,0 +1,149 @@
+#include <assert.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+
+#include "../src/futex_rwlatch.h"
+#include "../src/queue_lock.h"
+#include "../src/rwlock.h"
+#include "bench_util.h"
+
+/**
+ * Latches used as plain mutexes through their write side.
+ */
+template <typename Latch>
+class WriteSide {
+ public:
+  void lock() { latch_.WLock(); }
+  void unlock() { latch_.WUnlock(); }
+
+ private:
+  Latch latch_;
+};
+
+/**
+ * Critical section of the suite: bump a counter and touch a few lines of
+ * shared data, so handoffs have to move real cache lines.
+ */
+struct Protected {
+  alignas(64) uint64_t count{0};
+  uint64_t lines[4 * 8]{};
+
+  void Write() {
+    count++;
+    for (int i = 0; i < 4; ++i) {
+      lines[i * 8]++;
+    }
+  }
+
+  auto Read() const -> uint64_t {
+    uint64_t sum = 0;
+    for (int i = 0; i < 4; ++i) {
+      sum += lines[i * 8];
+    }
+    return sum;
+  }
+};
+
+template <typename Mutex>
+auto run_exclusive(int threads, std::chrono::milliseconds duration) -> double {
+  Mutex mutex;
+  Protected data;
+  auto ops = bench::RunFor(threads, duration, [&](int, std::atomic<bool> &stop) {
+    uint64_t n = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+      std::lock_guard<Mutex> guard(mutex);
+      data.Write();
+      n++;
+    }
+    return n;
+  });
+  if (ops != data.count) {
+    std::cerr << "lost updates: " << data.count << " != " << ops << std::endl;
+    std::abort();
+  }
+  return ops / (duration.count() / 1000.0);
+}
+
+template <typename Latch>
+auto run_shared(int threads, int write_percent, std::chrono::milliseconds duration) -> double {
+  Latch latch;
+  Protected data;
+  std::atomic<uint64_t> writes{0};
+  auto ops = bench::RunFor(threads, duration, [&](int tid, std::atomic<bool> &stop) {
+    bench::FastRand rng(tid + 1);
+    uint64_t n = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+      if (static_cast<int>(rng.Next() % 100) < write_percent) {
+        latch.WLock();
+        data.Write();
+        latch.WUnlock();
+        writes.fetch_add(1, std::memory_order_relaxed);
+      } else {
+        latch.RLock();
+        auto sum = data.Read();
+        latch.RUnlock();
+        if (sum % 4 != 0) {
+          std::cerr << "torn read: " << sum << std::endl;
+          std::abort();
+        }
+      }
+      n++;
+    }
+    return n;
+  });
+  if (writes.load() != data.count) {
+    std::cerr << "lost updates: " << data.count << " != " << writes.load() << std::endl;
+    std::abort();
+  }
+  return ops / (duration.count() / 1000.0);
+}
+
+int main(int argc, char **argv) {
+  assert(argc == 4 && "usage: ./queue_lock_bench <max_threads> <write_percent> <millis_per_run>");
+  int max_threads = std::stoi(argv[1]);
+  int write_percent = std::stoi(argv[2]);
+  std::chrono::milliseconds duration(std::stoi(argv[3]));
+
+  std::cout << "--------Bench Spec--------" << std::endl;
+  std::cout << "max threads: " << max_threads << std::endl;
+  std::cout << "write percent (reader-writer suite): " << write_percent << std::endl;
+  std::cout << "millis per run: " << duration.count() << std::endl;
+  std::cout << "--------------------------" << std::endl;
+
+  using bustub::waitpolicy::Spin;
+  using bustub::waitpolicy::SpinThenPark;
+
+  std::cout << "exclusive (ops/s)" << std::endl;
+  std::cout << std::setw(8) << "threads" << std::setw(13) << "std::mutex" << std::setw(13) << "rwlatch"
+            << std::setw(13) << "futex" << std::setw(13) << "mcs-spin" << std::setw(13) << "mcs-park"
+            << std::setw(13) << "clh-spin" << std::setw(13) << "clh-park" << std::endl;
+  for (int threads : bench::ThreadCounts(max_threads)) {
+    std::cout << std::setw(8) << threads << std::fixed << std::setprecision(0)
+              << std::setw(13) << run_exclusive<std::mutex>(threads, duration)
+              << std::setw(13) << run_exclusive<WriteSide<bustub::ReaderWriterLatch>>(threads, duration)
+              << std::setw(13) << run_exclusive<WriteSide<bustub::FutexReaderWriterLatch>>(threads, duration)
+              << std::setw(13) << run_exclusive<bustub::McsLock<Spin>>(threads, duration)
+              << std::setw(13) << run_exclusive<bustub::McsLock<SpinThenPark>>(threads, duration)
+              << std::setw(13) << run_exclusive<bustub::ClhLock<Spin>>(threads, duration)
+              << std::setw(13) << run_exclusive<bustub::ClhLock<SpinThenPark>>(threads, duration) << std::endl;
+  }
+
+  std::cout << "reader-writer (ops/s)" << std::endl;
+  std::cout << std::setw(8) << "threads" << std::setw(13) << "rwlatch" << std::setw(13) << "futex"
+            << std::setw(13) << "rwmcs-spin" << std::setw(13) << "rwmcs-park" << std::endl;
+  for (int threads : bench::ThreadCounts(max_threads)) {
+    std::cout << std::setw(8) << threads << std::fixed << std::setprecision(0)
+              << std::setw(13) << run_shared<bustub::ReaderWriterLatch>(threads, write_percent, duration)
+              << std::setw(13) << run_shared<bustub::FutexReaderWriterLatch>(threads, write_percent, duration)
+              << std::setw(13) << run_shared<bustub::McsReaderWriterLock<Spin>>(threads, write_percent, duration)
+              << std::setw(13)
+              << run_shared<bustub::McsReaderWriterLock<SpinThenPark>>(threads, write_percent, duration)
+              << std::endl;
+  }
+  return 0;
+}
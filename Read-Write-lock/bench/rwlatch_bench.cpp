@@ -0,0 +1,92 @@
+#include <assert.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <shared_mutex>
+#include <string>
+
+#include "../src/biased_rwlatch.h"
+#include "../src/futex_rwlatch.h"
+#include "../src/rwlock.h"
+#include "../src/sharded_rwlatch.h"
+#include "bench_util.h"
+
+/**
+ * std::shared_mutex behind the latch API, as a baseline.
+ */
+class SharedMutexLatch {
+ public:
+  void WLock() { mutex_.lock(); }
+  void WUnlock() { mutex_.unlock(); }
+  void RLock() { mutex_.lock_shared(); }
+  void RUnlock() { mutex_.unlock_shared(); }
+
+ private:
+  std::shared_mutex mutex_;
+};
+
+/**
+ * Writers keep the two halves equal, readers check they never see them
+ * differ, so a broken latch fails loudly instead of just looking fast.
+ */
+struct Shared {
+  alignas(64) uint64_t a{0};
+  uint64_t b{0};
+};
+
+template <typename Latch>
+auto run(int threads, int write_percent, std::chrono::milliseconds duration) -> double {
+  Latch latch;
+  Shared shared;
+  auto ops = bench::RunFor(threads, duration, [&](int tid, std::atomic<bool> &stop) {
+    bench::FastRand rng(tid + 1);
+    uint64_t n = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+      if (static_cast<int>(rng.Next() % 100) < write_percent) {
+        latch.WLock();
+        shared.a++;
+        shared.b++;
+        latch.WUnlock();
+      } else {
+        latch.RLock();
+        auto a = shared.a;
+        auto b = shared.b;
+        latch.RUnlock();
+        if (a != b) {
+          std::cerr << "torn read: " << a << " != " << b << std::endl;
+          std::abort();
+        }
+      }
+      n++;
+    }
+    return n;
+  });
+  return ops / (duration.count() / 1000.0);
+}
+
+int main(int argc, char **argv) {
+  assert(argc == 4 && "usage: ./rwlatch_bench <max_threads> <write_percent> <millis_per_run>");
+  int max_threads = std::stoi(argv[1]);
+  int write_percent = std::stoi(argv[2]);
+  std::chrono::milliseconds duration(std::stoi(argv[3]));
+
+  std::cout << "--------Bench Spec--------" << std::endl;
+  std::cout << "max threads: " << max_threads << std::endl;
+  std::cout << "write percent: " << write_percent << std::endl;
+  std::cout << "millis per run: " << duration.count() << std::endl;
+  std::cout << "--------------------------" << std::endl;
+
+  std::cout << std::setw(8) << "threads" << std::setw(16) << "mutex+cv" << std::setw(16) << "futex"
+            << std::setw(16) << "biased" << std::setw(16) << "sharded" << std::setw(16) << "shared_mutex" << "   (ops/s)" << std::endl;
+  for (int threads : bench::ThreadCounts(max_threads)) {
+    std::cout << std::setw(8) << threads << std::fixed << std::setprecision(0)
+              << std::setw(16) << run<bustub::ReaderWriterLatch>(threads, write_percent, duration)
+              << std::setw(16) << run<bustub::FutexReaderWriterLatch>(threads, write_percent, duration)
+              << std::setw(16) << run<bustub::ReaderBiasedLatch<>>(threads, write_percent, duration)
+              << std::setw(16) << run<bustub::ShardedReaderWriterLatch<>>(threads, write_percent, duration)
+              << std::setw(16) << run<SharedMutexLatch>(threads, write_percent, duration) << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,98 @@
+#include <assert.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "../src/futex_rwlatch.h"
+#include "../src/rwlock.h"
+#include "../src/seqlock.h"
+#include "bench_util.h"
+
+/**
+ * A config snapshot, every writer keeps all fields equal so a reader can
+ * detect a torn copy.
+ */
+struct Config {
+  uint64_t version;
+  uint64_t limit;
+  uint64_t timeout;
+  uint64_t flags;
+};
+
+void check(const Config &c) {
+  if (c.version != c.limit || c.version != c.timeout || c.version != c.flags) {
+    std::cerr << "torn read at version " << c.version << std::endl;
+    std::abort();
+  }
+}
+
+auto next(const Config &c) -> Config { return {c.version + 1, c.version + 1, c.version + 1, c.version + 1}; }
+
+template <typename Latch>
+auto run_latch(int threads, int write_permille, std::chrono::milliseconds duration) -> double {
+  Latch latch;
+  Config config{};
+  auto ops = bench::RunFor(threads, duration, [&](int tid, std::atomic<bool> &stop) {
+    bench::FastRand rng(tid + 1);
+    uint64_t n = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+      if (static_cast<int>(rng.Next() % 1000) < write_permille) {
+        latch.WLock();
+        config = next(config);
+        latch.WUnlock();
+      } else {
+        latch.RLock();
+        Config copy = config;
+        latch.RUnlock();
+        check(copy);
+      }
+      n++;
+    }
+    return n;
+  });
+  return ops / (duration.count() / 1000.0);
+}
+
+auto run_seqlock(int threads, int write_permille, std::chrono::milliseconds duration) -> double {
+  bustub::SeqLock<Config> config;
+  auto ops = bench::RunFor(threads, duration, [&](int tid, std::atomic<bool> &stop) {
+    bench::FastRand rng(tid + 1);
+    uint64_t n = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+      if (static_cast<int>(rng.Next() % 1000) < write_permille) {
+        config.Update(next);
+      } else {
+        check(config.Load());
+      }
+      n++;
+    }
+    return n;
+  });
+  return ops / (duration.count() / 1000.0);
+}
+
+int main(int argc, char **argv) {
+  assert(argc == 4 && "usage: ./seqlock_bench <max_threads> <write_permille> <millis_per_run>");
+  int max_threads = std::stoi(argv[1]);
+  int write_permille = std::stoi(argv[2]);
+  std::chrono::milliseconds duration(std::stoi(argv[3]));
+
+  std::cout << "--------Bench Spec--------" << std::endl;
+  std::cout << "max threads: " << max_threads << std::endl;
+  std::cout << "write permille: " << write_permille << std::endl;
+  std::cout << "millis per run: " << duration.count() << std::endl;
+  std::cout << "--------------------------" << std::endl;
+
+  std::cout << std::setw(8) << "threads" << std::setw(16) << "rwlatch" << std::setw(16) << "futex"
+            << std::setw(16) << "seqlock" << "   (ops/s)" << std::endl;
+  for (int threads : bench::ThreadCounts(max_threads)) {
+    std::cout << std::setw(8) << threads << std::fixed << std::setprecision(0)
+              << std::setw(16) << run_latch<bustub::ReaderWriterLatch>(threads, write_permille, duration)
+              << std::setw(16) << run_latch<bustub::FutexReaderWriterLatch>(threads, write_permille, duration)
+              << std::setw(16) << run_seqlock(threads, write_permille, duration) << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,167 @@
+#include <assert.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "../src/futex_rwlatch.h"
+#include "../src/optimistic_latch.h"
+#include "bench_util.h"
+
+/**
+ * Node of a sorted list whose shape never changes, only values are
+ * rewritten. `check` is always ~value, a reader that sees them disagree
+ * read a torn node.
+ */
+struct Node {
+  bustub::OptimisticLatch olc;
+  bustub::FutexReaderWriterLatch latch;
+  std::atomic<uint64_t> key{0};
+  std::atomic<uint64_t> value{0};
+  std::atomic<uint64_t> check{~uint64_t{0}};
+  std::atomic<Node *> next{nullptr};
+};
+
+class List {
+ public:
+  explicit List(int length) {
+    for (int i = 0; i < length; ++i) {
+      nodes_.push_back(std::make_unique<Node>());
+      nodes_.back()->key.store(i, std::memory_order_relaxed);
+      if (i > 0) {
+        nodes_[i - 1]->next.store(nodes_.back().get(), std::memory_order_relaxed);
+      }
+    }
+  }
+
+  auto Length() const -> int { return nodes_.size(); }
+  auto At(int i) -> Node & { return *nodes_[i]; }
+  auto Head() -> Node * { return nodes_.front().get(); }
+
+ private:
+  std::vector<std::unique_ptr<Node>> nodes_;
+};
+
+//! keeps the lookups from being optimized away
+std::atomic<uint64_t> sink{0};
+
+void verify(uint64_t value, uint64_t check) {
+  if (check != ~value) {
+    std::cerr << "torn node: " << value << " / " << check << std::endl;
+    std::abort();
+  }
+}
+
+/**
+ * Hand-over-hand shared latching: every step writes the latch word of the
+ * next node and of the one left behind.
+ */
+auto lookup_coupled(List &list, uint64_t key) -> uint64_t {
+  auto node = list.Head();
+  node->latch.RLock();
+  while (node->key.load(std::memory_order_relaxed) != key) {
+    auto next = node->next.load(std::memory_order_relaxed);
+    next->latch.RLock();
+    node->latch.RUnlock();
+    node = next;
+  }
+  auto value = node->value.load(std::memory_order_relaxed);
+  verify(value, node->check.load(std::memory_order_relaxed));
+  node->latch.RUnlock();
+  return value;
+}
+
+/**
+ * Optimistic lock coupling: only version loads, restart on any conflict.
+ */
+auto lookup_optimistic(List &list, uint64_t key) -> uint64_t {
+  return bustub::OptimisticRetry([&]() -> std::optional<uint64_t> {
+    auto node = list.Head();
+    auto version = node->olc.RLockOptimistic();
+    if (!version.has_value()) {
+      return std::nullopt;
+    }
+    while (node->key.load(std::memory_order_relaxed) != key) {
+      auto next = node->next.load(std::memory_order_relaxed);
+      version = bustub::CoupleOptimistic(node->olc, *version, next->olc);
+      if (!version.has_value()) {
+        return std::nullopt;
+      }
+      node = next;
+    }
+    auto value = node->value.load(std::memory_order_relaxed);
+    auto check = node->check.load(std::memory_order_relaxed);
+    if (!node->olc.Validate(*version)) {
+      return std::nullopt;
+    }
+    verify(value, check);
+    return value;
+  });
+}
+
+void write(Node &node) {
+  auto value = node.value.load(std::memory_order_relaxed) + 1;
+  node.value.store(value, std::memory_order_relaxed);
+  node.check.store(~value, std::memory_order_relaxed);
+}
+
+template <bool Optimistic>
+auto run(int threads, int length, int write_percent, std::chrono::milliseconds duration) -> double {
+  List list(length);
+  auto ops = bench::RunFor(threads, duration, [&](int tid, std::atomic<bool> &stop) {
+    bench::FastRand rng(tid + 1);
+    uint64_t n = 0;
+    uint64_t sum = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+      auto key = rng.Next() % length;
+      if (static_cast<int>(rng.Next() % 100) < write_percent) {
+        auto &node = list.At(key);
+        if constexpr (Optimistic) {
+          node.olc.WLock();
+          write(node);
+          node.olc.WUnlock();
+        } else {
+          node.latch.WLock();
+          write(node);
+          node.latch.WUnlock();
+        }
+      } else {
+        sum += Optimistic ? lookup_optimistic(list, key) : lookup_coupled(list, key);
+      }
+      n++;
+    }
+    sink.fetch_add(sum, std::memory_order_relaxed);
+    return n;
+  });
+  return ops / (duration.count() / 1000.0);
+}
+
+int main(int argc, char **argv) {
+  assert(argc == 5 && "usage: ./traversal_bench <max_threads> <list_length> <write_percent> <millis_per_run>");
+  int max_threads = std::stoi(argv[1]);
+  int length = std::stoi(argv[2]);
+  int write_percent = std::stoi(argv[3]);
+  std::chrono::milliseconds duration(std::stoi(argv[4]));
+
+  std::cout << "--------Bench Spec--------" << std::endl;
+  std::cout << "max threads: " << max_threads << std::endl;
+  std::cout << "list length: " << length << std::endl;
+  std::cout << "write percent: " << write_percent << std::endl;
+  std::cout << "millis per run: " << duration.count() << std::endl;
+  std::cout << "--------------------------" << std::endl;
+
+  std::cout << std::setw(8) << "threads" << std::setw(18) << "coupled rwlatch" << std::setw(18) << "optimistic"
+            << "   (lookups+writes/s)" << std::endl;
+  for (int threads : bench::ThreadCounts(max_threads)) {
+    std::cout << std::setw(8) << threads << std::fixed << std::setprecision(0) << std::setw(18)
+              << run<false>(threads, length, write_percent, duration) << std::setw(18)
+              << run<true>(threads, length, write_percent, duration) << std::endl;
+  }
+  return 0;
+}
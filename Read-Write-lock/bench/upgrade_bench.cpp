@@ -0,0 +1,197 @@
+#include <assert.h>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../src/rwlatch_guard.h"
+#include "../src/rwlock.h"
+#include "bench_util.h"
+
+struct Spec {
+  int upgraders;
+  int writers;
+  int readers;
+  uint64_t hold_ns;
+  std::chrono::microseconds timeout;
+  std::chrono::milliseconds duration;
+};
+
+/**
+ * Upgraders read the value, then upgrade half of the time and write it back
+ * plus one while writers increment it and readers read it. An upgrade that
+ * let a writer in between would lose that writer's increment.
+ */
+template <typename Policy>
+void run_upgrade(const Spec &spec) {
+  bustub::BasicReaderWriterLatch<Policy> latch;
+  uint64_t value = 0;
+  int threads = spec.upgraders + spec.writers + spec.readers;
+  std::vector<uint64_t> upgrades(threads);
+  std::vector<uint64_t> lost(threads);
+  auto total = bench::RunFor(threads, spec.duration, [&](int tid, std::atomic<bool> &stop) {
+    bench::FastRand rand(tid);
+    uint64_t ops = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+      if (tid < spec.upgraders) {
+        bustub::UpgradeLatchGuard guard(latch);
+        auto seen = value;
+        bench::SpinFor(spec.hold_ns);
+        if ((rand.Next() & 1) != 0) {
+          guard.Upgrade();
+          lost[tid] += value != seen;
+          value = seen + 1;
+          upgrades[tid]++;
+        }
+      } else if (tid < spec.upgraders + spec.writers) {
+        bustub::WriteLatchGuard guard(latch);
+        value++;
+        bench::SpinFor(spec.hold_ns);
+      } else {
+        bustub::ReadLatchGuard guard(latch);
+        bench::SpinFor(spec.hold_ns);
+      }
+      ops++;
+    }
+    return ops;
+  });
+
+  uint64_t upgraded = 0;
+  uint64_t lost_total = 0;
+  for (int t = 0; t < threads; ++t) {
+    upgraded += upgrades[t];
+    lost_total += lost[t];
+  }
+  // each writer op and each upgrade added exactly one
+  auto writes = value - upgraded;
+  std::cout << "  upgrade  ops/s " << std::setw(10) << total * 1000 / spec.duration.count() << "  upgrades "
+            << std::setw(8) << upgraded << "  writes " << std::setw(8) << writes << "  lost updates " << lost_total
+            << std::endl;
+  assert(lost_total == 0 && "a writer got in between ULock and Upgrade");
+}
+
+/**
+ * One thread keeps the write latch for several timeouts at a time, the
+ * others try to get it in write, read or upgradeable mode with a deadline
+ * one timeout away, and without waiting. A failed timed attempt must not
+ * return before its deadline; how late it returns is the overshoot.
+ */
+template <typename Policy>
+void run_timed(const Spec &spec) {
+  using clock = std::chrono::steady_clock;
+  bustub::BasicReaderWriterLatch<Policy> latch;
+  int threads = std::max(spec.upgraders + spec.writers + spec.readers, 2);
+  std::vector<std::vector<uint64_t>> overshoot(threads);
+  std::vector<uint64_t> timed(threads);
+  std::vector<uint64_t> early(threads);
+  std::vector<uint64_t> instant(threads);
+  std::vector<uint64_t> instant_failed(threads);
+  auto hold = std::chrono::duration_cast<std::chrono::nanoseconds>(spec.timeout).count();
+  bench::RunFor(threads, spec.duration, [&](int tid, std::atomic<bool> &stop) {
+    uint64_t ops = 0;
+    if (tid == 0) {
+      while (!stop.load(std::memory_order_relaxed)) {
+        latch.WLock();
+        bench::SpinFor(hold * 4);
+        latch.WUnlock();
+        bench::SpinFor(hold / 4);
+        ops++;
+      }
+      return ops;
+    }
+    auto &samples = overshoot[tid];
+    while (!stop.load(std::memory_order_relaxed)) {
+      auto deadline = clock::now() + spec.timeout;
+      bool got = false;
+      switch (tid % 3) {
+        case 0:
+          if ((got = latch.TryWLockUntil(deadline))) {
+            latch.WUnlock();
+          }
+          break;
+        case 1:
+          if ((got = latch.TryRLockUntil(deadline))) {
+            latch.RUnlock();
+          }
+          break;
+        default:
+          if ((got = latch.TryULockUntil(deadline))) {
+            latch.UUnlock();
+          }
+          break;
+      }
+      timed[tid]++;
+      if (!got) {
+        auto now = clock::now();
+        early[tid] += now < deadline;
+        samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(now - deadline).count());
+      }
+
+      bool now_got;
+      if (tid % 2 == 0) {
+        if ((now_got = latch.TryWLock())) {
+          latch.WUnlock();
+        }
+      } else if ((now_got = latch.TryRLock())) {
+        latch.RUnlock();
+      }
+      instant[tid]++;
+      instant_failed[tid] += !now_got;
+      ops++;
+    }
+    return ops;
+  });
+
+  bench::Latencies late;
+  uint64_t tries = 0;
+  uint64_t early_total = 0;
+  uint64_t instant_total = 0;
+  uint64_t instant_failed_total = 0;
+  for (int t = 1; t < threads; ++t) {
+    late.Add(overshoot[t]);
+    tries += timed[t];
+    early_total += early[t];
+    instant_total += instant[t];
+    instant_failed_total += instant_failed[t];
+  }
+  std::cout << "  timed    tries " << std::setw(8) << tries << "  expired " << std::setw(8) << late.Count()
+            << "  early " << early_total << "  overshoot us p50 " << std::setw(7) << late.Percentile(50) / 1000.0
+            << " p99 " << std::setw(7) << late.Percentile(99) / 1000.0 << "  try-now " << instant_total
+            << " failed " << instant_failed_total << std::endl;
+  assert(early_total == 0 && "a timed acquire gave up before its deadline");
+}
+
+template <typename Policy>
+void run(const char *name, const Spec &spec) {
+  std::cout << name << std::endl;
+  std::cout << std::fixed << std::setprecision(1);
+  run_upgrade<Policy>(spec);
+  run_timed<Policy>(spec);
+}
+
+int main(int argc, char **argv) {
+  assert(argc == 7 &&
+         "usage: ./upgrade_bench <upgraders> <writers> <readers> <hold_ns> <timeout_us> <millis_per_run>");
+  Spec spec{std::stoi(argv[1]),
+            std::stoi(argv[2]),
+            std::stoi(argv[3]),
+            std::stoull(argv[4]),
+            std::chrono::microseconds(std::stoi(argv[5])),
+            std::chrono::milliseconds(std::stoi(argv[6]))};
+
+  std::cout << "--------Bench Spec--------" << std::endl;
+  std::cout << "upgraders: " << spec.upgraders << std::endl;
+  std::cout << "writers: " << spec.writers << std::endl;
+  std::cout << "readers: " << spec.readers << std::endl;
+  std::cout << "hold ns: " << spec.hold_ns << std::endl;
+  std::cout << "timeout us: " << spec.timeout.count() << std::endl;
+  std::cout << "millis per run: " << spec.duration.count() << std::endl;
+  std::cout << "--------------------------" << std::endl;
+
+  run<bustub::rwpolicy::ReaderPreferring>("reader-preferring", spec);
+  run<bustub::rwpolicy::WriterPreferring>("writer-preferring", spec);
+  run<bustub::rwpolicy::PhaseFair>("phase-fair", spec);
+  return 0;
+}
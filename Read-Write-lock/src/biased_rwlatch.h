@@ -0,0 +1,192 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// biased_rwlatch.h
+//
+// Reader-biased latch: readers publish themselves in a shared slot table
+// instead of touching the latch (BRAVO, Dice & Kogan, ATC'19).
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+#include "futex.h"
+#include "futex_rwlatch.h"
+
+namespace bustub {
+
+namespace details {
+
+/**
+ * Visible readers table shared by every ReaderBiasedLatch in the process.
+ * A fast-path reader stores the address of its latch in one slot; a writer
+ * revoking the bias waits until no slot names its latch any more.
+ */
+class VisibleReaders {
+ public:
+  static constexpr size_t SLOTS = 4096;
+
+  static auto Table() -> VisibleReaders & {
+    static VisibleReaders table;
+    return table;
+  }
+
+  auto Slot(const void *latch) -> std::atomic<const void *> & {
+    // mix the latch into a per-thread seed so one thread's readers of
+    // different latches spread out, and so do many threads on one latch
+    thread_local const uint64_t seed = Mix(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    return slots_[Mix(seed ^ reinterpret_cast<uintptr_t>(latch)) % SLOTS];
+  }
+
+  /**
+   * Spin until no reader is published for `latch`.
+   */
+  void Drain(const void *latch) {
+    for (auto &slot : slots_) {
+      while (slot.load(std::memory_order_seq_cst) == latch) {
+        CpuRelax();
+      }
+    }
+  }
+
+ private:
+  static auto Mix(uint64_t x) -> uint64_t {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return x;
+  }
+
+  std::atomic<const void *> slots_[SLOTS]{};
+};
+
+/**
+ * Fast-path read holds of the calling thread, newest last. Two threads can
+ * hash to the same slot, so RUnlock goes by this record of what RLock did
+ * rather than by what the slot holds now.
+ */
+struct FastReads {
+  static constexpr size_t MAX = 8;
+
+  struct Hold {
+    const void *latch;
+    std::atomic<const void *> *slot;
+  };
+
+  static auto Local() -> FastReads & {
+    thread_local FastReads reads;
+    return reads;
+  }
+
+  Hold holds[MAX];
+  size_t count{0};
+};
+
+}  // namespace details
+
+/**
+ * Reader-Writer latch for read-mostly data, wrapping an underlying latch.
+ *
+ * While the latch is read-biased a reader never writes the latch itself: it
+ * CASes its slot in the global visible readers table, so readers on
+ * different cores touch different cache lines. A writer first takes the
+ * underlying write latch, clears the bias and waits for every published
+ * reader to leave. Readers that find the bias cleared, or their slot taken,
+ * fall back to the underlying latch.
+ *
+ * Revocation costs a scan of the whole table, so after one the bias stays
+ * off for INHIBIT_FACTOR times as long as the scan took; a slow-path reader
+ * turns it back on once that window has passed.
+ */
+template <typename Latch = FutexReaderWriterLatch>
+class ReaderBiasedLatch {
+  static constexpr int64_t INHIBIT_FACTOR = 9;
+
+ public:
+  ReaderBiasedLatch() = default;
+  ~ReaderBiasedLatch() = default;
+  ReaderBiasedLatch(const ReaderBiasedLatch &) = delete;
+  ReaderBiasedLatch &operator=(const ReaderBiasedLatch &) = delete;
+
+  /**
+   * Acquire a write latch.
+   */
+  void WLock() {
+    latch_.WLock();
+    if (read_bias_.load(std::memory_order_relaxed)) {
+      // seq_cst store then seq_cst slot loads, pairs with the reader's
+      // slot CAS then bias load: one of the two must see the other
+      read_bias_.store(false, std::memory_order_seq_cst);
+      auto start = Now();
+      details::VisibleReaders::Table().Drain(this);
+      auto now = Now();
+      inhibit_until_.store(now + (now - start) * INHIBIT_FACTOR, std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * Release a write latch.
+   */
+  void WUnlock() { latch_.WUnlock(); }
+
+  /**
+   * Acquire a read latch.
+   */
+  void RLock() {
+    auto &reads = details::FastReads::Local();
+    if (read_bias_.load(std::memory_order_relaxed) && reads.count < details::FastReads::MAX) {
+      auto &slot = details::VisibleReaders::Table().Slot(this);
+      const void *expected = nullptr;
+      if (slot.compare_exchange_strong(expected, this, std::memory_order_seq_cst)) {
+        if (read_bias_.load(std::memory_order_seq_cst)) {
+          reads.holds[reads.count++] = {this, &slot};
+          return;
+        }
+        // a writer is revoking, step back out of its way
+        slot.store(nullptr, std::memory_order_release);
+      }
+    }
+    latch_.RLock();
+    if (!read_bias_.load(std::memory_order_relaxed) && Now() >= inhibit_until_.load(std::memory_order_relaxed)) {
+      // release: a fast-path reader that sees the bias must also see what
+      // the last writer wrote before we got the read latch
+      read_bias_.store(true, std::memory_order_release);
+    }
+  }
+
+  /**
+   * Release a read latch.
+   */
+  void RUnlock() {
+    auto &reads = details::FastReads::Local();
+    for (size_t i = reads.count; i-- > 0;) {
+      if (reads.holds[i].latch == this) {
+        reads.holds[i].slot->store(nullptr, std::memory_order_release);
+        std::copy(reads.holds + i + 1, reads.holds + reads.count, reads.holds + i);
+        reads.count--;
+        return;
+      }
+    }
+    latch_.RUnlock();
+  }
+
+ private:
+  static auto Now() -> int64_t {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  Latch latch_;
+  std::atomic<bool> read_bias_{true};
+  std::atomic<int64_t> inhibit_until_{0};
+};
+
+}  // namespace bustub
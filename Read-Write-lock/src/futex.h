@@ -0,0 +1,60 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// futex.h
+//
+// Thin wrappers over the linux futex syscall for latches built on one
+// atomic word.
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <ctime>
+
+namespace bustub {
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex words are plain 32-bit ints");
+
+/**
+ * Sleep while `*word == expected`. Returns false only on timeout; spurious
+ * wakeups return true, so callers always re-check their condition.
+ */
+inline auto FutexWait(std::atomic<uint32_t> *word, uint32_t expected, const timespec *timeout = nullptr)
+    -> bool {
+  auto rc = syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAIT_PRIVATE, expected, timeout,
+                    nullptr, 0);
+  return !(rc == -1 && errno == ETIMEDOUT);
+}
+
+/**
+ * Wake up to `count` threads sleeping on `word`, returns how many woke.
+ */
+inline auto FutexWake(std::atomic<uint32_t> *word, int count) -> int {
+  return static_cast<int>(
+      syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0));
+}
+
+inline auto FutexWakeAll(std::atomic<uint32_t> *word) -> int { return FutexWake(word, INT_MAX); }
+
+/**
+ * Tell the core we are in a spin loop.
+ */
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
+#endif
+}
+
+}  // namespace bustub
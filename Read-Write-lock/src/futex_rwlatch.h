@@ -0,0 +1,214 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// futex_rwlatch.h
+//
+// Reader-writer latch on a single atomic state word.
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "futex.h"
+
+namespace bustub {
+
+/**
+ * Reader-Writer latch built on one 32-bit state word, a drop-in replacement
+ * for ReaderWriterLatch.
+ *
+ * The low 30 bits hold the reader count, or WRITE_LOCKED when a writer owns
+ * the latch. The two high bits record that readers / writers are asleep.
+ * Uncontended RLock, RUnlock, WLock and WUnlock are one atomic RMW each;
+ * threads only enter the kernel when they actually have to wait.
+ *
+ * Like ReaderWriterLatch the latch prefers writers: once a writer is waiting
+ * new readers queue up behind it. Readers sleep on `state_`, writers sleep on
+ * `writer_notify_` so a release can wake exactly one writer.
+ */
+class FutexReaderWriterLatch {
+  static constexpr uint32_t READ_LOCKED = 1;
+  static constexpr uint32_t MASK = (1U << 30) - 1;
+  static constexpr uint32_t WRITE_LOCKED = MASK;
+  static constexpr uint32_t MAX_READERS = MASK - 1;
+  static constexpr uint32_t READERS_WAITING = 1U << 30;
+  static constexpr uint32_t WRITERS_WAITING = 1U << 31;
+  static constexpr int SPIN_LIMIT = 100;
+
+ public:
+  FutexReaderWriterLatch() = default;
+  ~FutexReaderWriterLatch() = default;
+  FutexReaderWriterLatch(const FutexReaderWriterLatch &) = delete;
+  FutexReaderWriterLatch &operator=(const FutexReaderWriterLatch &) = delete;
+
+  /**
+   * Acquire a write latch.
+   */
+  void WLock() {
+    uint32_t expected = 0;
+    if (!state_.compare_exchange_strong(expected, WRITE_LOCKED, std::memory_order_acquire,
+                                        std::memory_order_relaxed)) {
+      WLockContended();
+    }
+  }
+
+  /**
+   * Release a write latch.
+   */
+  void WUnlock() {
+    uint32_t state = state_.fetch_sub(WRITE_LOCKED, std::memory_order_release) - WRITE_LOCKED;
+    if (HasWaiters(state)) {
+      WakeWriterOrReaders(state);
+    }
+  }
+
+  /**
+   * Acquire a read latch.
+   */
+  void RLock() {
+    uint32_t state = state_.load(std::memory_order_relaxed);
+    if (!IsReadLockable(state) || !state_.compare_exchange_weak(state, state + READ_LOCKED, std::memory_order_acquire,
+                                                                std::memory_order_relaxed)) {
+      RLockContended();
+    }
+  }
+
+  /**
+   * Release a read latch.
+   */
+  void RUnlock() {
+    uint32_t state = state_.fetch_sub(READ_LOCKED, std::memory_order_release) - READ_LOCKED;
+    // readers only ever sleep behind a writer, so the last reader out only
+    // has to care about writers
+    if (IsUnlocked(state) && (state & WRITERS_WAITING) != 0) {
+      WakeWriterOrReaders(state);
+    }
+  }
+
+ private:
+  static auto IsUnlocked(uint32_t state) -> bool { return (state & MASK) == 0; }
+  static auto IsWriteLocked(uint32_t state) -> bool { return (state & MASK) == WRITE_LOCKED; }
+  static auto HasWaiters(uint32_t state) -> bool { return (state & ~MASK) != 0; }
+
+  static auto IsReadLockable(uint32_t state) -> bool {
+    // waiting readers or writers block new readers, the former so that a
+    // woken batch of readers does not starve the writer queued behind it
+    return (state & MASK) < MAX_READERS && !HasWaiters(state);
+  }
+
+  void RLockContended() {
+    uint32_t state = SpinRead();
+    while (true) {
+      if (IsReadLockable(state)) {
+        if (state_.compare_exchange_weak(state, state + READ_LOCKED, std::memory_order_acquire,
+                                         std::memory_order_relaxed)) {
+          return;
+        }
+        continue;
+      }
+      if ((state & READERS_WAITING) == 0) {
+        if (!state_.compare_exchange_weak(state, state | READERS_WAITING, std::memory_order_relaxed)) {
+          continue;
+        }
+      }
+      FutexWait(&state_, state | READERS_WAITING);
+      state = SpinRead();
+    }
+  }
+
+  void WLockContended() {
+    uint32_t state = SpinWrite();
+    // once we slept, other writers may be asleep too, and whoever takes the
+    // latch must keep WRITERS_WAITING set for them
+    uint32_t other_writers_waiting = 0;
+    while (true) {
+      if (IsUnlocked(state)) {
+        if (state_.compare_exchange_weak(state, state | WRITE_LOCKED | other_writers_waiting,
+                                         std::memory_order_acquire, std::memory_order_relaxed)) {
+          return;
+        }
+        continue;
+      }
+      if ((state & WRITERS_WAITING) == 0) {
+        if (!state_.compare_exchange_weak(state, state | WRITERS_WAITING, std::memory_order_relaxed)) {
+          continue;
+        }
+      }
+      other_writers_waiting = WRITERS_WAITING;
+
+      // read the notify counter before re-checking the state, so a release
+      // in between bumps it and the wait returns immediately
+      uint32_t seq = writer_notify_.load(std::memory_order_acquire);
+      state = state_.load(std::memory_order_relaxed);
+      if (IsUnlocked(state) || (state & WRITERS_WAITING) == 0) {
+        continue;
+      }
+      FutexWait(&writer_notify_, seq);
+      state = SpinWrite();
+    }
+  }
+
+  /**
+   * Called with the latch unlocked and waiter bits set: hand it to one
+   * writer if any is asleep, otherwise wake every reader.
+   */
+  void WakeWriterOrReaders(uint32_t state) {
+    if (state == WRITERS_WAITING) {
+      if (state_.compare_exchange_strong(state, 0, std::memory_order_relaxed)) {
+        WakeWriter();
+        return;
+      }
+    }
+    if (state == (READERS_WAITING | WRITERS_WAITING)) {
+      if (!state_.compare_exchange_strong(state, READERS_WAITING, std::memory_order_relaxed)) {
+        // someone grabbed the latch, their unlock will do the waking
+        return;
+      }
+      if (WakeWriter()) {
+        return;
+      }
+      // no writer was actually asleep, so nobody will wake the readers later
+      state = READERS_WAITING;
+    }
+    if (state == READERS_WAITING) {
+      if (state_.compare_exchange_strong(state, 0, std::memory_order_relaxed)) {
+        FutexWakeAll(&state_);
+      }
+    }
+  }
+
+  auto WakeWriter() -> bool {
+    writer_notify_.fetch_add(1, std::memory_order_release);
+    return FutexWake(&writer_notify_, 1) > 0;
+  }
+
+  /**
+   * Spin briefly while the latch is held but nobody sleeps yet, a short
+   * critical section usually ends before a futex round trip would.
+   */
+  auto SpinUntil(bool (*done)(uint32_t)) -> uint32_t {
+    uint32_t state = state_.load(std::memory_order_relaxed);
+    for (int spin = 0; spin < SPIN_LIMIT && !done(state); ++spin) {
+      CpuRelax();
+      state = state_.load(std::memory_order_relaxed);
+    }
+    return state;
+  }
+
+  auto SpinRead() -> uint32_t {
+    return SpinUntil([](uint32_t s) { return !IsWriteLocked(s) || HasWaiters(s); });
+  }
+
+  auto SpinWrite() -> uint32_t {
+    return SpinUntil([](uint32_t s) { return IsUnlocked(s) || HasWaiters(s); });
+  }
+
+  alignas(64) std::atomic<uint32_t> state_{0};
+  std::atomic<uint32_t> writer_notify_{0};
+};
+
+}  // namespace bustub
@@ -0,0 +1,340 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// latch_profiler.h
+//
+// Contention profiler for the reader-writer latch: wait and hold times per
+// call site and role, kept in per-thread histograms.
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+//! build with -DBUSTUB_LATCH_PROFILE=1 to record latch contention
+#ifndef BUSTUB_LATCH_PROFILE
+#define BUSTUB_LATCH_PROFILE 0
+#endif
+
+#include <cstdint>
+#include <iosfwd>
+
+#if BUSTUB_LATCH_PROFILE
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <source_location>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#endif
+
+namespace bustub {
+
+namespace profile {
+
+enum class Role : uint8_t { Read, Write, Upgrade };
+
+#if BUSTUB_LATCH_PROFILE
+
+/**
+ * Call site of a latch acquire, defaulted at every instrumented method.
+ */
+using LatchSite = std::source_location;
+
+inline auto RoleName(Role role) -> const char * {
+  switch (role) {
+    case Role::Read:
+      return "read";
+    case Role::Write:
+      return "write";
+    case Role::Upgrade:
+      return "upgrade";
+  }
+  return "?";
+}
+
+inline auto NowNanos() -> uint64_t {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+/**
+ * Log2 histogram of nanosecond durations, bucket i counts [2^(i-1), 2^i).
+ */
+class Histogram {
+ public:
+  static constexpr int BUCKETS = 64;
+
+  void Add(uint64_t ns) {
+    buckets_[ns == 0 ? 0 : 64 - __builtin_clzll(ns)]++;
+    count_++;
+    max_ = std::max(max_, ns);
+  }
+
+  void Merge(const Histogram &other) {
+    for (int i = 0; i < BUCKETS; ++i) {
+      buckets_[i] += other.buckets_[i];
+    }
+    count_ += other.count_;
+    max_ = std::max(max_, other.max_);
+  }
+
+  /**
+   * Upper bound of the bucket holding the p-th percentile.
+   */
+  auto Percentile(double p) const -> uint64_t {
+    auto rank = static_cast<uint64_t>(p / 100 * count_);
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; ++i) {
+      seen += buckets_[i];
+      if (seen > rank) {
+        return std::min(i == 0 ? 0 : (uint64_t{1} << i) - 1, max_);
+      }
+    }
+    return max_;
+  }
+
+  auto Count() const -> uint64_t { return count_; }
+  auto Max() const -> uint64_t { return max_; }
+
+ private:
+  uint64_t buckets_[BUCKETS]{};
+  uint64_t count_{0};
+  uint64_t max_{0};
+};
+
+/**
+ * Everything recorded for one (call site, role).
+ */
+struct SiteProfile {
+  std::string file;
+  uint32_t line{0};
+  std::string function;
+  Role role{Role::Read};
+  uint64_t acquisitions{0};
+  uint64_t contended{0};
+  Histogram wait;
+  Histogram hold;
+};
+
+inline auto operator<<(std::ostream &os, const SiteProfile &s) -> std::ostream & {
+  auto us = [](uint64_t ns) { return ns / 1000.0; };
+  auto file = s.file.substr(s.file.find_last_of('/') + 1);
+  os << std::left << std::setw(7) << RoleName(s.role) << std::right << " " << file << ":" << s.line << " "
+     << s.function << "\n"
+     << std::fixed << std::setprecision(1) << "    acquisitions " << s.acquisitions << " contended "
+     << s.contended << " (" << (s.acquisitions ? 100.0 * s.contended / s.acquisitions : 0.0) << "%)"
+     << "  wait us p50 " << us(s.wait.Percentile(50)) << " p99 " << us(s.wait.Percentile(99)) << " max "
+     << us(s.wait.Max()) << "  hold us p50 " << us(s.hold.Percentile(50)) << " p99 " << us(s.hold.Percentile(99))
+     << " max " << us(s.hold.Max()) << "\n";
+  return os;
+}
+
+namespace details {
+
+/**
+ * Sites recorded by one thread. Only the owner writes, the mutex is there
+ * for Dump and is never contended otherwise.
+ */
+struct ThreadProfile {
+  struct Key {
+    const char *file;
+    const char *function;
+    uint32_t line;
+    uint32_t column;
+    Role role;
+    auto operator==(const Key &) const -> bool = default;
+  };
+  struct KeyHash {
+    auto operator()(const Key &k) const -> size_t {
+      return std::hash<const void *>{}(k.file) ^ std::hash<const void *>{}(k.function) ^
+             (static_cast<size_t>(k.line) << 16) ^ k.column ^ (static_cast<size_t>(k.role) << 8);
+    }
+  };
+
+  /**
+   * A latch the thread holds and where it got it.
+   */
+  struct Held {
+    const void *latch;
+    SiteProfile *site;
+    uint64_t since;
+  };
+
+  std::mutex mutex;
+  std::unordered_map<Key, SiteProfile, KeyHash> sites;
+  std::vector<Held> held;
+
+  auto Site(const LatchSite &loc, Role role) -> SiteProfile & {
+    auto [it, fresh] = sites.try_emplace(Key{loc.file_name(), loc.function_name(), loc.line(), loc.column(), role});
+    if (fresh) {
+      it->second.file = loc.file_name();
+      it->second.line = loc.line();
+      it->second.function = loc.function_name();
+      it->second.role = role;
+    }
+    return it->second;
+  }
+};
+
+/**
+ * Every thread's profile, kept after the thread exits so a later Dump
+ * still sees it.
+ */
+class Registry {
+ public:
+  static auto Instance() -> Registry & {
+    static Registry registry;
+    return registry;
+  }
+
+  auto Local() -> ThreadProfile & {
+    thread_local ThreadProfile *local = nullptr;
+    if (local == nullptr) {
+      std::lock_guard<std::mutex> guard(mutex_);
+      threads_.push_back(std::make_unique<ThreadProfile>());
+      local = threads_.back().get();
+    }
+    return *local;
+  }
+
+  auto Snapshot() -> std::vector<SiteProfile> {
+    std::vector<SiteProfile> merged;
+    std::lock_guard<std::mutex> guard(mutex_);
+    for (auto &thread : threads_) {
+      std::lock_guard<std::mutex> thread_guard(thread->mutex);
+      for (const auto &[key, site] : thread->sites) {
+        auto it = std::find_if(merged.begin(), merged.end(), [&](const SiteProfile &m) {
+          return m.line == site.line && m.role == site.role && m.file == site.file && m.function == site.function;
+        });
+        if (it == merged.end()) {
+          merged.push_back(site);
+          continue;
+        }
+        it->acquisitions += site.acquisitions;
+        it->contended += site.contended;
+        it->wait.Merge(site.wait);
+        it->hold.Merge(site.hold);
+      }
+    }
+    return merged;
+  }
+
+  void Reset() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    for (auto &thread : threads_) {
+      std::lock_guard<std::mutex> thread_guard(thread->mutex);
+      // held entries point into the map, keep the sites and zero them
+      for (auto &[key, site] : thread->sites) {
+        site.acquisitions = 0;
+        site.contended = 0;
+        site.wait = Histogram{};
+        site.hold = Histogram{};
+      }
+    }
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<ThreadProfile>> threads_;
+};
+
+}  // namespace details
+
+/**
+ * Measures one acquire: created before waiting, told whether the latch was
+ * contended, and closed once the latch is held.
+ */
+class AcquireProbe {
+ public:
+  AcquireProbe(Role role, LatchSite site) : role_(role), site_(site), start_(NowNanos()) {}
+
+  void Contended() { contended_ = true; }
+
+  void Acquired(const void *latch) {
+    auto now = NowNanos();
+    auto &thread = details::Registry::Instance().Local();
+    std::lock_guard<std::mutex> guard(thread.mutex);
+    auto &site = thread.Site(site_, role_);
+    site.acquisitions++;
+    site.contended += contended_ ? 1 : 0;
+    site.wait.Add(now - start_);
+    thread.held.push_back({latch, &site, now});
+  }
+
+ private:
+  Role role_;
+  LatchSite site_;
+  uint64_t start_;
+  bool contended_{false};
+};
+
+/**
+ * Record the hold time of the latest acquire of `latch` by this thread.
+ */
+inline void Released(const void *latch) {
+  auto now = NowNanos();
+  auto &thread = details::Registry::Instance().Local();
+  std::lock_guard<std::mutex> guard(thread.mutex);
+  for (auto it = thread.held.rbegin(); it != thread.held.rend(); ++it) {
+    if (it->latch == latch) {
+      it->site->hold.Add(now - it->since);
+      thread.held.erase(std::next(it).base());
+      return;
+    }
+  }
+}
+
+/**
+ * All call sites recorded so far, merged across threads.
+ */
+inline auto Snapshot() -> std::vector<SiteProfile> { return details::Registry::Instance().Snapshot(); }
+
+/**
+ * Write every call site, most waited-on first.
+ */
+inline void Dump(std::ostream &os) {
+  auto sites = Snapshot();
+  // sites zeroed by Reset and not hit since
+  std::erase_if(sites, [](const SiteProfile &s) { return s.acquisitions == 0; });
+  std::sort(sites.begin(), sites.end(), [](const SiteProfile &a, const SiteProfile &b) {
+    return a.wait.Percentile(99) * a.acquisitions > b.wait.Percentile(99) * b.acquisitions;
+  });
+  os << "[latch profile] " << sites.size() << " call sites\n";
+  for (const auto &site : sites) {
+    os << site;
+  }
+}
+
+inline void Reset() { details::Registry::Instance().Reset(); }
+
+#else
+
+/**
+ * Stand-in for std::source_location, an empty parameter the optimizer drops.
+ */
+struct LatchSite {
+  static constexpr auto current() -> LatchSite { return {}; }
+};
+
+class AcquireProbe {
+ public:
+  constexpr AcquireProbe(Role, LatchSite) {}
+  void Contended() {}
+  void Acquired(const void *) {}
+};
+
+inline void Released(const void *) {}
+inline void Dump(std::ostream &) {}
+inline void Reset() {}
+
+#endif
+
+}  // namespace profile
+
+}  // namespace bustub
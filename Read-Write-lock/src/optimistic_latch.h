@@ -0,0 +1,143 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// optimistic_latch.h
+//
+// Versioned latch for optimistic lock coupling (Leis et al., "The ART of
+// Practical Synchronization", DaMoN'16).
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+
+#include "futex.h"
+
+namespace bustub {
+
+/**
+ * Latch whose readers do not write shared memory. A reader remembers the
+ * version, reads, and then validates that the version did not change; if it
+ * did, the reader restarts. Writers lock exclusively and bump the version on
+ * release.
+ *
+ * The word is version << 2 | locked << 1 | obsolete. Locking adds 0b10 and
+ * unlocking adds 0b10 again, which clears the bit and carries into the
+ * version. A node that was unlinked is marked obsolete so readers that
+ * still reach it restart instead of spinning on it.
+ *
+ * Data read between RLockOptimistic and Validate may be torn, so it must be
+ * held in (relaxed) atomics and must not be trusted, e.g. dereferenced as a
+ * pointer into freed memory, before validation succeeds.
+ */
+class OptimisticLatch {
+  static constexpr uint64_t OBSOLETE = 0b01;
+  static constexpr uint64_t LOCKED = 0b10;
+
+ public:
+  OptimisticLatch() = default;
+  OptimisticLatch(const OptimisticLatch &) = delete;
+  OptimisticLatch &operator=(const OptimisticLatch &) = delete;
+
+  /**
+   * Start an optimistic read: wait until no writer holds the latch and
+   * return the version, or nullopt if the latch is obsolete.
+   */
+  auto RLockOptimistic() const -> std::optional<uint64_t> {
+    uint64_t version = word_.load(std::memory_order_acquire);
+    while ((version & LOCKED) != 0) {
+      CpuRelax();
+      version = word_.load(std::memory_order_acquire);
+    }
+    if ((version & OBSOLETE) != 0) {
+      return std::nullopt;
+    }
+    return version;
+  }
+
+  /**
+   * True if nothing was written since `version` was read, so everything
+   * read in between is consistent.
+   */
+  auto Validate(uint64_t version) const -> bool {
+    // keeps the data loads before it from sinking below the version load
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return word_.load(std::memory_order_relaxed) == version;
+  }
+
+  /**
+   * Turn an optimistic read into a write latch, false if a writer got in
+   * since `version`.
+   */
+  auto TryUpgrade(uint64_t version) -> bool {
+    if (!word_.compare_exchange_strong(version, version + LOCKED, std::memory_order_acquire,
+                                       std::memory_order_relaxed)) {
+      return false;
+    }
+    // keeps the writes that follow from rising above the lock
+    std::atomic_thread_fence(std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Acquire the write latch, false if the latch is obsolete.
+   */
+  auto WLock() -> bool {
+    while (true) {
+      auto version = RLockOptimistic();
+      if (!version.has_value()) {
+        return false;
+      }
+      if (TryUpgrade(*version)) {
+        return true;
+      }
+    }
+  }
+
+  /**
+   * Release the write latch, invalidating every optimistic read in flight.
+   */
+  void WUnlock() { word_.fetch_add(LOCKED, std::memory_order_release); }
+
+  /**
+   * Release the write latch of a node that was unlinked.
+   */
+  void WUnlockObsolete() { word_.fetch_add(LOCKED | OBSOLETE, std::memory_order_release); }
+
+ private:
+  std::atomic<uint64_t> word_{0};
+};
+
+/**
+ * One step of optimistic lock coupling: start reading `child`, then make
+ * sure `parent` did not change since `parent_version`, i.e. the pointer that
+ * led to `child` was valid. nullopt means restart from the root.
+ */
+inline auto CoupleOptimistic(const OptimisticLatch &parent, uint64_t parent_version, const OptimisticLatch &child)
+    -> std::optional<uint64_t> {
+  auto version = child.RLockOptimistic();
+  if (!version.has_value() || !parent.Validate(parent_version)) {
+    return std::nullopt;
+  }
+  return version;
+}
+
+/**
+ * Run the optimistic operation `attempt` until it does not ask for a
+ * restart, i.e. returns an engaged optional, and return its value.
+ */
+template <typename Attempt>
+auto OptimisticRetry(Attempt attempt) {
+  while (true) {
+    if (auto result = attempt(); result.has_value()) {
+      return *result;
+    }
+    CpuRelax();
+  }
+}
+
+}  // namespace bustub
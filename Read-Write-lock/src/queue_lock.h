@@ -0,0 +1,413 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// queue_lock.h
+//
+// Queue locks: MCS, CLH and the fair reader-writer MCS lock. Every waiter
+// spins on its own queue node instead of a shared word, and each release
+// hands the lock to exactly one successor.
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+#include "futex.h"
+#include "spin_wait.h"
+
+namespace bustub {
+
+namespace details {
+
+/**
+ * Grant word of a queue node. Only the node's owner waits on it.
+ */
+template <typename Wait>
+class GrantWord {
+  static_assert(std::is_same_v<Wait, waitpolicy::Spin> || std::is_same_v<Wait, waitpolicy::SpinThenPark>,
+                "queue locks spin or spin then park");
+  static constexpr uint32_t GRANTED = 0;
+  static constexpr uint32_t WAITING = 1;
+  static constexpr uint32_t PARKED = 2;
+  static constexpr int SPIN_LIMIT = 1000;
+
+ public:
+  void Reset() { word_.store(WAITING, std::memory_order_relaxed); }
+
+  void Await() {
+    for (int spin = 0; std::is_same_v<Wait, waitpolicy::Spin> || spin < SPIN_LIMIT; ++spin) {
+      if (word_.load(std::memory_order_acquire) == GRANTED) {
+        return;
+      }
+      CpuRelax();
+    }
+    uint32_t expected = WAITING;
+    if (word_.compare_exchange_strong(expected, PARKED, std::memory_order_acquire)) {
+      expected = PARKED;
+    }
+    while (expected != GRANTED) {
+      FutexWait(&word_, PARKED);
+      expected = word_.load(std::memory_order_acquire);
+    }
+  }
+
+  void Grant() {
+    if (word_.exchange(GRANTED, std::memory_order_release) == PARKED) {
+      // the node may already be reused by now, a stray wake is harmless
+      FutexWake(&word_, 1);
+    }
+  }
+
+ private:
+  std::atomic<uint32_t> word_{GRANTED};
+};
+
+/**
+ * Per-thread free list of queue nodes, so Lock/Unlock need no node argument
+ * and do not allocate after warm-up. Nodes are only freed when the thread
+ * exits.
+ */
+template <typename Node>
+class NodePool {
+ public:
+  static auto Get() -> Node * {
+    auto &free = Local().free_;
+    if (free.empty()) {
+      return new Node;
+    }
+    auto node = free.back();
+    free.pop_back();
+    return node;
+  }
+
+  static void Put(Node *node) { Local().free_.push_back(node); }
+
+ private:
+  ~NodePool() {
+    for (auto node : free_) {
+      delete node;
+    }
+  }
+
+  static auto Local() -> NodePool & {
+    thread_local NodePool pool;
+    return pool;
+  }
+
+  std::vector<Node *> free_;
+};
+
+}  // namespace details
+
+/**
+ * MCS lock (Mellor-Crummey & Scott, TOCS'91): waiters form a linked queue
+ * through the tail pointer and each spins on its own node; the holder hands
+ * the lock straight to its successor. FIFO and one cache line transfer per
+ * handoff.
+ */
+template <typename Wait = waitpolicy::SpinThenPark>
+class McsLock {
+  struct Node {
+    std::atomic<Node *> next{nullptr};
+    details::GrantWord<Wait> grant;
+  };
+  using Pool = details::NodePool<Node>;
+
+ public:
+  McsLock() = default;
+  McsLock(const McsLock &) = delete;
+  McsLock &operator=(const McsLock &) = delete;
+
+  void Lock() {
+    auto node = Pool::Get();
+    node->next.store(nullptr, std::memory_order_relaxed);
+    node->grant.Reset();
+    auto pred = tail_.exchange(node, std::memory_order_acq_rel);
+    if (pred != nullptr) {
+      pred->next.store(node, std::memory_order_release);
+      node->grant.Await();
+    }
+    holder_ = node;
+  }
+
+  void Unlock() {
+    auto node = holder_;
+    auto next = node->next.load(std::memory_order_acquire);
+    if (next == nullptr) {
+      auto expected = node;
+      if (tail_.compare_exchange_strong(expected, nullptr, std::memory_order_acq_rel)) {
+        Pool::Put(node);
+        return;
+      }
+      // a successor swapped itself in but has not linked yet
+      while ((next = node->next.load(std::memory_order_acquire)) == nullptr) {
+        CpuRelax();
+      }
+    }
+    next->grant.Grant();
+    Pool::Put(node);
+  }
+
+  void lock() { Lock(); }
+  void unlock() { Unlock(); }
+
+ private:
+  alignas(64) std::atomic<Node *> tail_{nullptr};
+  // only read and written by the holder
+  Node *holder_{nullptr};
+};
+
+/**
+ * CLH lock (Craig; Landin & Hagersten): an implicit queue where each waiter
+ * spins on its predecessor's node. Release is a single store with no CAS,
+ * and the releaser's node is passed on to the successor, which recycles its
+ * predecessor's node in turn.
+ */
+template <typename Wait = waitpolicy::SpinThenPark>
+class ClhLock {
+  struct Node {
+    details::GrantWord<Wait> grant;
+  };
+  using Pool = details::NodePool<Node>;
+
+ public:
+  ClhLock() : tail_(new Node) {}
+  ~ClhLock() { delete tail_.load(std::memory_order_relaxed); }
+  ClhLock(const ClhLock &) = delete;
+  ClhLock &operator=(const ClhLock &) = delete;
+
+  void Lock() {
+    auto node = Pool::Get();
+    node->grant.Reset();
+    auto pred = tail_.exchange(node, std::memory_order_acq_rel);
+    pred->grant.Await();
+    // nobody touches the predecessor's node any more, it becomes ours
+    Pool::Put(pred);
+    holder_ = node;
+  }
+
+  void Unlock() { holder_->grant.Grant(); }
+
+  void lock() { Lock(); }
+  void unlock() { Unlock(); }
+
+ private:
+  alignas(64) std::atomic<Node *> tail_;
+  // only read and written by the holder
+  Node *holder_{nullptr};
+};
+
+/**
+ * Fair reader-writer queue lock (Mellor-Crummey & Scott, PPoPP'91): readers
+ * and writers queue in arrival order, consecutive readers in the queue hold
+ * the lock together, and each waiter spins on its own node.
+ *
+ * A node's state word packs whether it is still blocked and what kind of
+ * successor it has; a reader queued behind a waiting reader registers
+ * itself there so it is released together with its predecessor.
+ */
+template <typename Wait = waitpolicy::SpinThenPark>
+class McsReaderWriterLock {
+  static constexpr uint32_t BLOCKED = 1;
+  static constexpr uint32_t PARKED = 2;
+  static constexpr uint32_t SUCCESSOR_READER = 4;
+  static constexpr uint32_t SUCCESSOR_WRITER = 8;
+  static constexpr uint32_t SUCCESSOR_MASK = SUCCESSOR_READER | SUCCESSOR_WRITER;
+  static constexpr int SPIN_LIMIT = 1000;
+  static_assert(std::is_same_v<Wait, waitpolicy::Spin> || std::is_same_v<Wait, waitpolicy::SpinThenPark>,
+                "queue locks spin or spin then park");
+
+  struct Node {
+    bool writer{false};
+    std::atomic<Node *> next{nullptr};
+    std::atomic<uint32_t> state{0};
+  };
+  using Pool = details::NodePool<Node>;
+
+  /**
+   * Nodes the calling thread currently holds, several readers of one lock
+   * can each hold a node so the lock cannot store them.
+   */
+  struct Held {
+    const void *lock;
+    Node *node;
+  };
+
+ public:
+  McsReaderWriterLock() = default;
+  McsReaderWriterLock(const McsReaderWriterLock &) = delete;
+  McsReaderWriterLock &operator=(const McsReaderWriterLock &) = delete;
+
+  void WLock() {
+    auto node = NewNode(true);
+    auto pred = tail_.exchange(node);
+    if (pred == nullptr) {
+      next_writer_.store(node);
+      if (reader_count_.load() == 0 && next_writer_.exchange(nullptr) == node) {
+        // no reader is left to release us
+        node->state.fetch_and(~BLOCKED);
+      }
+    } else {
+      pred->state.fetch_or(SUCCESSOR_WRITER);
+      pred->next.store(node);
+    }
+    Await(node);
+    Hold(node);
+  }
+
+  void WUnlock() {
+    auto node = Release();
+    auto next = WaitNext(node);
+    if (next != nullptr) {
+      if (!next->writer) {
+        reader_count_.fetch_add(1);
+      }
+      Unblock(next);
+    }
+    Pool::Put(node);
+  }
+
+  void RLock() {
+    auto node = NewNode(false);
+    auto pred = tail_.exchange(node);
+    if (pred == nullptr) {
+      reader_count_.fetch_add(1);
+      node->state.fetch_and(~BLOCKED);
+    } else if (pred->writer || RegisterReader(pred)) {
+      // pred is a writer or a waiting reader, it will count us in and
+      // release us
+      pred->next.store(node);
+      Await(node);
+    } else {
+      // pred is an active reader, join it
+      reader_count_.fetch_add(1);
+      pred->next.store(node);
+      node->state.fetch_and(~BLOCKED);
+    }
+    if ((node->state.load() & SUCCESSOR_READER) != 0) {
+      // a reader queued behind us while we waited, take it along
+      Node *next;
+      while ((next = node->next.load()) == nullptr) {
+        CpuRelax();
+      }
+      reader_count_.fetch_add(1);
+      Unblock(next);
+    }
+    Hold(node);
+  }
+
+  void RUnlock() {
+    auto node = Release();
+    auto next = WaitNext(node);
+    if (next != nullptr && (node->state.load() & SUCCESSOR_WRITER) != 0) {
+      next_writer_.store(next);
+    }
+    if (reader_count_.fetch_sub(1) == 1) {
+      auto writer = next_writer_.load();
+      if (writer != nullptr && reader_count_.load() == 0 && next_writer_.compare_exchange_strong(writer, nullptr)) {
+        Unblock(writer);
+      }
+    }
+    Pool::Put(node);
+  }
+
+  void lock() { WLock(); }
+  void unlock() { WUnlock(); }
+  void lock_shared() { RLock(); }
+  void unlock_shared() { RUnlock(); }
+
+ private:
+  static auto NewNode(bool writer) -> Node * {
+    auto node = Pool::Get();
+    node->writer = writer;
+    node->next.store(nullptr, std::memory_order_relaxed);
+    node->state.store(BLOCKED, std::memory_order_relaxed);
+    return node;
+  }
+
+  /**
+   * Mark a blocked reader predecessor as having a reader successor, false
+   * if it is already active.
+   */
+  static auto RegisterReader(Node *pred) -> bool {
+    uint32_t state = pred->state.load();
+    while ((state & BLOCKED) != 0 && (state & SUCCESSOR_MASK) == 0) {
+      if (pred->state.compare_exchange_weak(state, state | SUCCESSOR_READER)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static void Await(Node *node) {
+    for (int spin = 0; std::is_same_v<Wait, waitpolicy::Spin> || spin < SPIN_LIMIT; ++spin) {
+      if ((node->state.load() & BLOCKED) == 0) {
+        return;
+      }
+      CpuRelax();
+    }
+    uint32_t state = node->state.load();
+    while ((state & BLOCKED) != 0) {
+      if ((state & PARKED) != 0 || node->state.compare_exchange_weak(state, state | PARKED)) {
+        FutexWait(&node->state, state | PARKED);
+      }
+      state = node->state.load();
+    }
+  }
+
+  static void Unblock(Node *node) {
+    if ((node->state.fetch_and(~(BLOCKED | PARKED)) & PARKED) != 0) {
+      FutexWake(&node->state, 1);
+    }
+  }
+
+  /**
+   * Leave the queue if we are its tail, else the successor node, waiting
+   * for it to link itself.
+   */
+  auto WaitNext(Node *node) -> Node * {
+    auto next = node->next.load();
+    if (next != nullptr) {
+      return next;
+    }
+    auto expected = node;
+    if (tail_.compare_exchange_strong(expected, nullptr)) {
+      return nullptr;
+    }
+    while ((next = node->next.load()) == nullptr) {
+      CpuRelax();
+    }
+    return next;
+  }
+
+  static auto HeldNodes() -> std::vector<Held> & {
+    thread_local std::vector<Held> held;
+    return held;
+  }
+
+  void Hold(Node *node) { HeldNodes().push_back({this, node}); }
+
+  auto Release() -> Node * {
+    auto &held = HeldNodes();
+    for (auto it = held.rbegin(); it != held.rend(); ++it) {
+      if (it->lock == this) {
+        auto node = it->node;
+        held.erase(std::next(it).base());
+        return node;
+      }
+    }
+    return nullptr;
+  }
+
+  alignas(64) std::atomic<Node *> tail_{nullptr};
+  alignas(64) std::atomic<uint32_t> reader_count_{0};
+  std::atomic<Node *> next_writer_{nullptr};
+};
+
+}  // namespace bustub
@@ -0,0 +1,98 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// rwlatch_guard.h
+//
+// RAII guards for the reader-writer latches. Latches that take a call site
+// for profiling get the guard's own call site.
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include "latch_profiler.h"
+
+namespace bustub {
+
+/**
+ * Holds a read latch for its lifetime.
+ */
+template <typename Latch>
+class ReadLatchGuard {
+ public:
+  explicit ReadLatchGuard(Latch &latch, profile::LatchSite site = profile::LatchSite::current()) : latch_(latch) {
+    if constexpr (requires { latch.RLock(site); }) {
+      latch_.RLock(site);
+    } else {
+      latch_.RLock();
+    }
+  }
+  ~ReadLatchGuard() { latch_.RUnlock(); }
+  ReadLatchGuard(const ReadLatchGuard &) = delete;
+  ReadLatchGuard &operator=(const ReadLatchGuard &) = delete;
+
+ private:
+  Latch &latch_;
+};
+
+/**
+ * Holds a write latch for its lifetime.
+ */
+template <typename Latch>
+class WriteLatchGuard {
+ public:
+  explicit WriteLatchGuard(Latch &latch, profile::LatchSite site = profile::LatchSite::current()) : latch_(latch) {
+    if constexpr (requires { latch.WLock(site); }) {
+      latch_.WLock(site);
+    } else {
+      latch_.WLock();
+    }
+  }
+  ~WriteLatchGuard() { latch_.WUnlock(); }
+  WriteLatchGuard(const WriteLatchGuard &) = delete;
+  WriteLatchGuard &operator=(const WriteLatchGuard &) = delete;
+
+ private:
+  Latch &latch_;
+};
+
+/**
+ * Holds an upgradeable read latch, or the write latch it was upgraded to,
+ * for its lifetime.
+ */
+template <typename Latch>
+class UpgradeLatchGuard {
+ public:
+  explicit UpgradeLatchGuard(Latch &latch, profile::LatchSite site = profile::LatchSite::current())
+      : latch_(latch) {
+    latch_.ULock(site);
+  }
+  ~UpgradeLatchGuard() {
+    if (upgraded_) {
+      latch_.WUnlock();
+    } else {
+      latch_.UUnlock();
+    }
+  }
+  UpgradeLatchGuard(const UpgradeLatchGuard &) = delete;
+  UpgradeLatchGuard &operator=(const UpgradeLatchGuard &) = delete;
+
+  /**
+   * Switch to write mode, what was read under the guard stays valid.
+   */
+  void Upgrade(profile::LatchSite site = profile::LatchSite::current()) {
+    if (!upgraded_) {
+      latch_.Upgrade(site);
+      upgraded_ = true;
+    }
+  }
+
+  auto Upgraded() const -> bool { return upgraded_; }
+
+ private:
+  Latch &latch_;
+  bool upgraded_{false};
+};
+
+}  // namespace bustub
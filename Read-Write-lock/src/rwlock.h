@@ -12,87 +12,479 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <climits>
 #include <condition_variable>
+#include <cstdint>
 #include <mutex>
+#include <set>
+#include <type_traits>
+
+#include "latch_profiler.h"
+#include "spin_wait.h"
 
 namespace bustub {
 
+/**
+ * Fairness policies of BasicReaderWriterLatch, picked at compile time.
+ */
+namespace rwpolicy {
+
+/**
+ * Readers enter whenever no writer holds the latch. Best read throughput,
+ * but a steady stream of readers starves writers.
+ */
+struct ReaderPreferring {};
+
+/**
+ * The first waiting writer stops new readers from entering. Writers are not
+ * starved by readers, but a steady stream of writers starves readers.
+ */
+struct WriterPreferring {};
+
+/**
+ * Phase-fair: writers are served FIFO by ticket, and releasing a write latch
+ * admits every reader that queued behind it before the next writer may
+ * enter. Readers wait at most one write phase, writers at most one read
+ * phase per writer ahead of them.
+ */
+struct PhaseFair {};
+
+}  // namespace rwpolicy
+
 /**
  * Reader-Writer latch backed by std::mutex.
+ *
+ * Besides read and write mode it has an upgradeable read mode: one upgrader
+ * at a time shares the latch with plain readers, and can later turn its
+ * latch into a write latch without letting a writer in between, so whatever
+ * it read stays valid. While an upgrader holds the latch writers wait.
+ *
+ * Every acquire has a Try (no waiting) and a TryUntil (deadline) variant,
+ * and the std lock/lock_shared names make it usable with std::unique_lock
+ * and std::shared_lock.
+ *
+ * With BUSTUB_LATCH_PROFILE every acquire records its wait and hold time
+ * under its call site, see latch_profiler.h; otherwise the trailing `site`
+ * parameters are empty and compile away.
+ *
+ * With waitpolicy::Adaptive a thread that has to wait first releases the
+ * mutex and spins, with backoff, for the latch state to change, and only
+ * sleeps on the condition variable if that takes longer than recent waits
+ * did (see AdaptiveSpinner). Short critical sections then cost no futex
+ * sleep and wakeup. waitpolicy::Block always sleeps right away.
  */
-class ReaderWriterLatch {
+template <typename Policy, typename WaitPolicy = waitpolicy::Adaptive>
+class BasicReaderWriterLatch {
   using mutex_t = std::mutex;
   using cond_t = std::condition_variable;
+  using site_t = profile::LatchSite;
+  using probe_t = profile::AcquireProbe;
   static const uint32_t MAX_READERS = UINT_MAX;
 
+  static constexpr bool READER_PREFERRING = std::is_same_v<Policy, rwpolicy::ReaderPreferring>;
+  static constexpr bool WRITER_PREFERRING = std::is_same_v<Policy, rwpolicy::WriterPreferring>;
+  static constexpr bool PHASE_FAIR = std::is_same_v<Policy, rwpolicy::PhaseFair>;
+  static_assert(READER_PREFERRING || WRITER_PREFERRING || PHASE_FAIR, "unknown rwpolicy");
+  static constexpr bool ADAPTIVE = std::is_same_v<WaitPolicy, waitpolicy::Adaptive>;
+  static_assert(ADAPTIVE || std::is_same_v<WaitPolicy, waitpolicy::Block>, "the latch blocks or spins adaptively");
+
+  /* deadlines understood by the internal waits besides a time_point */
+  struct NoDeadline {};
+  struct Immediately {};
+
  public:
-  ReaderWriterLatch() = default;
-  ~ReaderWriterLatch() { std::lock_guard<mutex_t> guard(mutex_); }
-  ReaderWriterLatch(const ReaderWriterLatch &) = delete;
-  ReaderWriterLatch &operator=(const ReaderWriterLatch&) = delete;
+  BasicReaderWriterLatch() = default;
+  ~BasicReaderWriterLatch() { std::lock_guard<mutex_t> guard(mutex_); }
+  BasicReaderWriterLatch(const BasicReaderWriterLatch &) = delete;
+  BasicReaderWriterLatch &operator=(const BasicReaderWriterLatch&) = delete;
 
   /**
    * Acquire a write latch.
    */
-  void WLock() {
-    std::unique_lock<mutex_t> latch(mutex_);
-    while (writer_entered_) {
-        /* Only one writer could be writing at the same time */
-      reader_.wait(latch);
-    }
-    /* this thread is the one who are going to write next */
-    writer_entered_ = true;
-    /* after setting true, no more reader allowed to pass */
-    while (reader_count_ > 0) {
-        /* let any remaining reader finish their reading first */
-      writer_.wait(latch);
-    }
+  void WLock(site_t site = site_t::current()) { WLockUntil(NoDeadline{}, site); }
+
+  /**
+   * Try to acquire a write latch without waiting.
+   */
+  auto TryWLock(site_t site = site_t::current()) -> bool { return WLockUntil(Immediately{}, site); }
+
+  /**
+   * Try to acquire a write latch, giving up at `deadline`.
+   */
+  template <typename Clock, typename Duration>
+  auto TryWLockUntil(const std::chrono::time_point<Clock, Duration> &deadline, site_t site = site_t::current())
+      -> bool {
+    return WLockUntil(deadline, site);
   }
 
   /**
    * Release a write latch.
    */
   void WUnlock() {
+    profile::Released(this);
     std::lock_guard<mutex_t> guard(mutex_);
     writer_entered_ = false;
-    reader_.notify_all();
+    Changed();
+    if constexpr (READER_PREFERRING) {
+      reader_.notify_all();
+      writer_.notify_one();
+    } else if constexpr (WRITER_PREFERRING) {
+      reader_.notify_all();
+    } else {
+      EndWritePhase();
+    }
   }
 
   /**
    * Acquire a read latch.
    */
-  void RLock() {
-    std::unique_lock<mutex_t> latch(mutex_);
-    while (writer_entered_ || reader_count_ == MAX_READERS) {
-      reader_.wait(latch);
-    }
-    reader_count_++;
+  void RLock(site_t site = site_t::current()) { RLockUntil(NoDeadline{}, site); }
+
+  /**
+   * Try to acquire a read latch without waiting.
+   */
+  auto TryRLock(site_t site = site_t::current()) -> bool { return RLockUntil(Immediately{}, site); }
+
+  /**
+   * Try to acquire a read latch, giving up at `deadline`.
+   */
+  template <typename Clock, typename Duration>
+  auto TryRLockUntil(const std::chrono::time_point<Clock, Duration> &deadline, site_t site = site_t::current())
+      -> bool {
+    return RLockUntil(deadline, site);
   }
 
   /**
    * Release a read latch.
    */
   void RUnlock() {
+    profile::Released(this);
+    std::lock_guard<mutex_t> guard(mutex_);
+    RUnlockLocked();
+  }
+
+  /**
+   * Acquire an upgradeable read latch.
+   */
+  void ULock(site_t site = site_t::current()) { ULockUntil(NoDeadline{}, site); }
+
+  /**
+   * Try to acquire an upgradeable read latch without waiting.
+   */
+  auto TryULock(site_t site = site_t::current()) -> bool { return ULockUntil(Immediately{}, site); }
+
+  /**
+   * Try to acquire an upgradeable read latch, giving up at `deadline`.
+   */
+  template <typename Clock, typename Duration>
+  auto TryULockUntil(const std::chrono::time_point<Clock, Duration> &deadline, site_t site = site_t::current())
+      -> bool {
+    return ULockUntil(deadline, site);
+  }
+
+  /**
+   * Release an upgradeable read latch that was not upgraded.
+   */
+  void UUnlock() {
+    profile::Released(this);
     std::lock_guard<mutex_t> guard(mutex_);
+    upgrader_ = false;
+    RUnlockLocked();
+    /* writers and upgraders blocked on us wait on either cond */
+    reader_.notify_all();
+    writer_.notify_all();
+  }
+
+  /**
+   * Turn the held upgradeable read latch into a write latch, waiting for the
+   * other readers to leave. Release it with WUnlock.
+   */
+  void Upgrade(site_t site = site_t::current()) {
+    /* the upgradeable hold ends here, the write hold starts once we are in */
+    profile::Released(this);
+    probe_t probe(profile::Role::Write, site);
+    std::unique_lock<mutex_t> latch(mutex_);
+    /* no writer can be in or queued while we hold the upgrade latch, so we
+       are next: close the gate to new readers */
+    writer_entered_ = true;
+    if constexpr (PHASE_FAIR) {
+      next_ticket_++;
+    }
+    upgrader_ = false;
+    reader_count_--;
+    upgrading_ = true;
+    Wait(upgrade_, latch, NoDeadline{}, probe, [&] { return reader_count_ == 0; });
+    upgrading_ = false;
+    Changed();
+    /* writers waiting for the upgrader to leave now queue behind us */
+    writer_.notify_all();
+    latch.unlock();
+    probe.Acquired(this);
+  }
+
+  /* std SharedTimedLockable names, for std::unique_lock / std::shared_lock; called directly they record the caller */
+  void lock(site_t site = site_t::current()) { WLock(site); }
+  auto try_lock(site_t site = site_t::current()) -> bool { return TryWLock(site); }
+  template <typename Rep, typename Period>
+  auto try_lock_for(const std::chrono::duration<Rep, Period> &timeout, site_t site = site_t::current()) -> bool {
+    return TryWLockUntil(std::chrono::steady_clock::now() + timeout, site);
+  }
+  template <typename Clock, typename Duration>
+  auto try_lock_until(const std::chrono::time_point<Clock, Duration> &deadline, site_t site = site_t::current())
+      -> bool {
+    return TryWLockUntil(deadline, site);
+  }
+  void unlock() { WUnlock(); }
+  void lock_shared(site_t site = site_t::current()) { RLock(site); }
+  auto try_lock_shared(site_t site = site_t::current()) -> bool { return TryRLock(site); }
+  template <typename Rep, typename Period>
+  auto try_lock_shared_for(const std::chrono::duration<Rep, Period> &timeout, site_t site = site_t::current())
+      -> bool {
+    return TryRLockUntil(std::chrono::steady_clock::now() + timeout, site);
+  }
+  template <typename Clock, typename Duration>
+  auto try_lock_shared_until(const std::chrono::time_point<Clock, Duration> &deadline,
+                             site_t site = site_t::current()) -> bool {
+    return TryRLockUntil(deadline, site);
+  }
+  void unlock_shared() { RUnlock(); }
+
+ private:
+  /**
+   * Wait on `cond` until `done()` holds; false if `deadline` came first.
+   */
+  template <typename Deadline, typename Pred>
+  auto Wait(cond_t &cond, std::unique_lock<mutex_t> &latch, const Deadline &deadline, probe_t &probe, Pred done)
+      -> bool {
+    if (done()) {
+      return true;
+    }
+    probe.Contended();
+    if constexpr (std::is_same_v<Deadline, Immediately>) {
+      return false;
+    } else {
+      if constexpr (ADAPTIVE) {
+        if (SpinForChange(latch) && done()) {
+          return true;
+        }
+      }
+      if constexpr (std::is_same_v<Deadline, NoDeadline>) {
+        cond.wait(latch, done);
+        return true;
+      } else {
+        return cond.wait_until(latch, deadline, done);
+      }
+    }
+  }
+
+  template <typename Deadline>
+  auto WLockUntil(const Deadline &deadline, site_t site) -> bool {
+    probe_t probe(profile::Role::Write, site);
+    std::unique_lock<mutex_t> latch(mutex_);
+    if constexpr (READER_PREFERRING) {
+      if (!Wait(writer_, latch, deadline, probe,
+                [&] { return !writer_entered_ && reader_count_ == 0 && !upgrader_; })) {
+        return false;
+      }
+      writer_entered_ = true;
+    } else if constexpr (WRITER_PREFERRING) {
+      /* Only one writer could be writing at the same time */
+      if (!Wait(reader_, latch, deadline, probe, [&] { return !writer_entered_ && !upgrader_; })) {
+        return false;
+      }
+      /* this thread is the one who are going to write next */
+      writer_entered_ = true;
+      /* after setting true, no more reader allowed to pass */
+      /* let any remaining reader finish their reading first */
+      if (!Wait(writer_, latch, deadline, probe, [&] { return reader_count_ == 0; })) {
+        writer_entered_ = false;
+        Changed();
+        reader_.notify_all();
+        return false;
+      }
+    } else {
+      if (!Wait(writer_, latch, deadline, probe, [&] { return !upgrader_; })) {
+        return false;
+      }
+      /* taking a ticket also stops new readers from entering */
+      uint64_t ticket = next_ticket_++;
+      if (!Wait(writer_, latch, deadline, probe,
+                [&] { return serving_ticket_ == ticket && reader_count_ == 0; })) {
+        if (serving_ticket_ == ticket) {
+          /* our turn came but the readers did not drain in time: end our
+             (empty) write phase so the queued readers get in */
+          EndWritePhase();
+        } else {
+          abandoned_.insert(ticket);
+        }
+        return false;
+      }
+      writer_entered_ = true;
+    }
+    latch.unlock();
+    probe.Acquired(this);
+    return true;
+  }
+
+  template <typename Deadline>
+  auto RLockUntil(const Deadline &deadline, site_t site) -> bool {
+    probe_t probe(profile::Role::Read, site);
+    std::unique_lock<mutex_t> latch(mutex_);
+    if constexpr (PHASE_FAIR) {
+      if (next_ticket_ != serving_ticket_) {
+        /* a writer is in or queued: wait for its write phase to end, the
+           releasing writer counts us in */
+        waiting_readers_++;
+        uint64_t phase = phase_;
+        if (!Wait(reader_, latch, deadline, probe, [&] { return phase_ != phase; })) {
+          waiting_readers_--;
+          return false;
+        }
+        latch.unlock();
+        probe.Acquired(this);
+        return true;
+      }
+      if (!Wait(reader_, latch, deadline, probe, [&] { return reader_count_ < MAX_READERS; })) {
+        return false;
+      }
+    } else {
+      if (!Wait(reader_, latch, deadline, probe, [&] { return !writer_entered_ && reader_count_ < MAX_READERS; })) {
+        return false;
+      }
+    }
+    reader_count_++;
+    latch.unlock();
+    probe.Acquired(this);
+    return true;
+  }
+
+  template <typename Deadline>
+  auto ULockUntil(const Deadline &deadline, site_t site) -> bool {
+    probe_t probe(profile::Role::Upgrade, site);
+    std::unique_lock<mutex_t> latch(mutex_);
+    /* only enter when no writer is in or queued, so that Upgrade never has
+       to wait behind a writer that in turn waits for our read latch */
+    if (!Wait(reader_, latch, deadline, probe, [&] {
+          return !upgrader_ && !writer_entered_ && next_ticket_ == serving_ticket_ && reader_count_ < MAX_READERS;
+        })) {
+      return false;
+    }
+    upgrader_ = true;
+    reader_count_++;
+    latch.unlock();
+    probe.Acquired(this);
+    return true;
+  }
+
+  void RUnlockLocked() {
     reader_count_--;
-    if (writer_entered_) {
+    Changed();
+    if (upgrading_) {
+      if (reader_count_ == 0) {
+        upgrade_.notify_one();
+      }
+      return;
+    }
+    if constexpr (READER_PREFERRING) {
       if (reader_count_ == 0) {
         writer_.notify_one();
+      } else if (reader_count_ == MAX_READERS - 1) {
+        reader_.notify_one();
+      }
+    } else if constexpr (WRITER_PREFERRING) {
+      if (writer_entered_) {
+        if (reader_count_ == 0) {
+          writer_.notify_one();
+        }
+      } else {
+        if (reader_count_ == MAX_READERS - 1) {
+          reader_.notify_one();
+        }
       }
     } else {
-      if (reader_count_ == MAX_READERS - 1) {
+      if (next_ticket_ != serving_ticket_) {
+        if (reader_count_ == 0) {
+          writer_.notify_all();
+        }
+      } else if (reader_count_ == MAX_READERS - 1) {
         reader_.notify_one();
       }
     }
   }
 
- private:
+  /**
+   * Phase-fair: pass the turn to the next live ticket and hand the latch to
+   * every reader that queued during this write phase, the next writer then
+   * waits for them to leave.
+   */
+  void EndWritePhase() {
+    Changed();
+    serving_ticket_++;
+    while (!abandoned_.empty() && *abandoned_.begin() == serving_ticket_) {
+      abandoned_.erase(abandoned_.begin());
+      serving_ticket_++;
+    }
+    reader_count_ += waiting_readers_;
+    waiting_readers_ = 0;
+    phase_++;
+    reader_.notify_all();
+    /* writers wait on one cond with different tickets, wake them all */
+    writer_.notify_all();
+  }
+
+  /**
+   * Drop the mutex and spin until some release changes the latch state,
+   * false if the spin budget ran out first. Retakes the mutex either way.
+   */
+  auto SpinForChange(std::unique_lock<mutex_t> &latch) -> bool {
+    uint64_t seen = changes_.load(std::memory_order_relaxed);
+    latch.unlock();
+    bool changed = spinner_.Spin([&] { return changes_.load(std::memory_order_relaxed) != seen; });
+    latch.lock();
+    return changed;
+  }
+
+  /**
+   * Tell spinning waiters the state changed, called under the mutex.
+   */
+  void Changed() {
+    if constexpr (ADAPTIVE) {
+      changes_.store(changes_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+  }
+
   mutex_t mutex_;
   cond_t writer_;
   cond_t reader_;
+  cond_t upgrade_;
   uint32_t reader_count_{0};
   bool writer_entered_{false};
+
+  /* an upgradeable reader holds the latch, and whether it is waiting in
+     Upgrade for the other readers to leave */
+  bool upgrader_{false};
+  bool upgrading_{false};
+
+  /* phase-fair only: writer tickets, tickets of writers that timed out
+     before their turn, and readers parked until the current write phase
+     ends */
+  uint64_t next_ticket_{0};
+  uint64_t serving_ticket_{0};
+  std::set<uint64_t> abandoned_;
+  uint64_t phase_{0};
+  uint32_t waiting_readers_{0};
+
+  /* adaptive waiting only: bumped on every release, spun on outside the
+     mutex */
+  std::atomic<uint64_t> changes_{0};
+  AdaptiveSpinner spinner_;
 };
 
-}  // namespace bustub
\ No newline at end of file
+/**
+ * The original writer-preferring latch, waiting adaptively.
+ */
+using ReaderWriterLatch = BasicReaderWriterLatch<rwpolicy::WriterPreferring>;
+
+}  // namespace bustub
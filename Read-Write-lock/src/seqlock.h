@@ -0,0 +1,143 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// seqlock.h
+//
+// Sequence lock for small trivially copyable values.
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "futex.h"
+
+namespace bustub {
+
+/**
+ * Sequence lock guarding one small value, for read-mostly state such as
+ * config snapshots where a reader-writer latch costs more than the copy.
+ *
+ * Readers never write shared memory: they copy the value and retry if the
+ * sequence number was odd (write in progress) or changed meanwhile. Writers
+ * make the sequence odd, store, and make it even again; concurrent writers
+ * serialize on the same word.
+ *
+ * The value lives in relaxed atomic words rather than a plain T, so the
+ * racing copy of a reader is not a data race; the fences order those word
+ * accesses against the sequence number (Boehm, "Can seqlocks get along with
+ * programming language memory models?", MSPC'12).
+ */
+template <typename T>
+class SeqLock {
+  static_assert(std::is_trivially_copyable_v<T>, "SeqLock copies the value word by word");
+  static constexpr size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+ public:
+  SeqLock() : SeqLock(T{}) {}
+  explicit SeqLock(const T &value) { StoreWords(value); }
+  SeqLock(const SeqLock &) = delete;
+  SeqLock &operator=(const SeqLock &) = delete;
+
+  /**
+   * Read a consistent copy of the value, retrying while writers interfere.
+   */
+  auto Load() const -> T {
+    T value;
+    while (!TryLoad(&value)) {
+      CpuRelax();
+    }
+    return value;
+  }
+
+  /**
+   * One read attempt, false if it overlapped a write.
+   */
+  auto TryLoad(T *value) const -> bool {
+    uint64_t before = seq_.load(std::memory_order_acquire);
+    if ((before & 1) != 0) {
+      return false;
+    }
+    uint64_t buffer[WORDS];
+    for (size_t i = 0; i < WORDS; ++i) {
+      buffer[i] = words_[i].load(std::memory_order_relaxed);
+    }
+    // keeps the word loads above from sinking below the re-check
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (seq_.load(std::memory_order_relaxed) != before) {
+      return false;
+    }
+    std::memcpy(value, buffer, sizeof(T));
+    return true;
+  }
+
+  /**
+   * Replace the value.
+   */
+  void Store(const T &value) {
+    uint64_t seq = BeginWrite();
+    StoreWords(value);
+    seq_.store(seq + 2, std::memory_order_release);
+  }
+
+  /**
+   * Replace the value with `fn(old value)`, atomically with respect to
+   * other writers.
+   */
+  template <typename Fn>
+  void Update(Fn fn) {
+    uint64_t seq = BeginWrite();
+    uint64_t buffer[WORDS];
+    for (size_t i = 0; i < WORDS; ++i) {
+      buffer[i] = words_[i].load(std::memory_order_relaxed);
+    }
+    T value;
+    std::memcpy(&value, buffer, sizeof(T));
+    StoreWords(fn(value));
+    seq_.store(seq + 2, std::memory_order_release);
+  }
+
+  /**
+   * Current sequence number, even while no write is in progress. It only
+   * grows, so readers can use it to tell whether the value changed.
+   */
+  auto Sequence() const -> uint64_t { return seq_.load(std::memory_order_acquire); }
+
+ private:
+  /**
+   * Flip the sequence from even to odd, returning the even value.
+   */
+  auto BeginWrite() -> uint64_t {
+    uint64_t seq = seq_.load(std::memory_order_relaxed);
+    while (true) {
+      // acquire orders this write after the previous writer's release of the sequence
+      if ((seq & 1) == 0 &&
+          seq_.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+        break;
+      }
+      CpuRelax();
+      seq = seq_.load(std::memory_order_relaxed);
+    }
+    // keeps the word stores that follow from rising above the odd sequence
+    std::atomic_thread_fence(std::memory_order_release);
+    return seq;
+  }
+
+  void StoreWords(const T &value) {
+    uint64_t buffer[WORDS] = {};
+    std::memcpy(buffer, &value, sizeof(T));
+    for (size_t i = 0; i < WORDS; ++i) {
+      words_[i].store(buffer[i], std::memory_order_relaxed);
+    }
+  }
+
+  alignas(64) std::atomic<uint64_t> seq_{0};
+  std::atomic<uint64_t> words_[WORDS];
+};
+
+}  // namespace bustub
@@ -0,0 +1,84 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// sharded_counter.h
+//
+// Counter spread over per-thread cache lines.
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+namespace bustub {
+
+/**
+ * Counter split into cache-line sized cells. Each thread is pinned to one
+ * cell, handed out round-robin, so increments from different cores land on
+ * different lines; Sum() walks every cell.
+ *
+ * A thread always hits the same cell, but a cell can go negative when a
+ * count is added on one thread and removed on another. Only the sum means
+ * anything.
+ */
+class ShardedCounter {
+ public:
+  /** `shards` is rounded up to a power of two, at least 1 */
+  explicit ShardedCounter(uint32_t shards = DefaultShards())
+      : mask_(std::bit_ceil(std::clamp(shards, 1U, 1U << 31)) - 1), cells_(new Cell[mask_ + 1]) {}
+  ShardedCounter(const ShardedCounter &) = delete;
+  ShardedCounter &operator=(const ShardedCounter &) = delete;
+
+  void Add(int64_t n, std::memory_order order = std::memory_order_relaxed) {
+    cells_[ThreadShard() & mask_].value.fetch_add(n, order);
+  }
+
+  /**
+   * Sum of every cell. Exact only while nobody adds; otherwise it includes
+   * some of the racing updates and misses others.
+   */
+  auto Sum(std::memory_order order = std::memory_order_relaxed) const -> int64_t {
+    int64_t sum = 0;
+    for (uint32_t i = 0; i <= mask_; ++i) {
+      sum += cells_[i].value.load(order);
+    }
+    return sum;
+  }
+
+  auto Shards() const -> uint32_t { return mask_ + 1; }
+
+  /**
+   * Two cells per hardware thread, a power of two between 8 and 128.
+   */
+  static auto DefaultShards() -> uint32_t {
+    uint32_t want = std::max(2 * std::thread::hardware_concurrency(), 8U);
+    uint32_t shards = 1;
+    while (shards < want && shards < 128) {
+      shards <<= 1;
+    }
+    return shards;
+  }
+
+ private:
+  struct alignas(64) Cell {
+    std::atomic<int64_t> value{0};
+  };
+
+  static auto ThreadShard() -> uint32_t {
+    static std::atomic<uint32_t> next{0};
+    thread_local const uint32_t shard = next.fetch_add(1, std::memory_order_relaxed);
+    return shard;
+  }
+
+  uint32_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+};
+
+}  // namespace bustub
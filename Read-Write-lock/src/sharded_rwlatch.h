@@ -0,0 +1,98 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// sharded_rwlatch.h
+//
+// Reader-writer latch whose reader count is a sharded counter, in the style
+// of Linux's percpu_rw_semaphore.
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+
+#include "futex.h"
+#include "futex_rwlatch.h"
+#include "sharded_counter.h"
+
+namespace bustub {
+
+/**
+ * Reader-Writer latch for read-mostly data whose readers only touch their
+ * own cell of a ShardedCounter, wrapping an underlying latch for writers.
+ *
+ * A reader adds one to its cell and checks the writer flag; if no writer is
+ * about, it is in. A writer takes the underlying write latch, raises the
+ * flag and waits for the summed reader count to drain to zero. A reader
+ * that sees the flag backs out, waits for the writer on the underlying read
+ * latch, and counts itself in while holding it, when no writer can start.
+ *
+ * Unlike ReaderBiasedLatch the reader cells belong to the latch, so every
+ * latch costs ShardedCounter::Shards() cache lines; use it for a few hot
+ * latches, not one per page.
+ */
+template <typename Latch = FutexReaderWriterLatch>
+class ShardedReaderWriterLatch {
+  static constexpr int SPIN_LIMIT = 1000;
+
+ public:
+  ShardedReaderWriterLatch() = default;
+  ~ShardedReaderWriterLatch() = default;
+  ShardedReaderWriterLatch(const ShardedReaderWriterLatch &) = delete;
+  ShardedReaderWriterLatch &operator=(const ShardedReaderWriterLatch &) = delete;
+
+  /**
+   * Acquire a write latch.
+   */
+  void WLock() {
+    latch_.WLock();
+    // seq_cst store then seq_cst cell loads, pairs with the reader's cell
+    // increment then flag load: one of the two must see the other
+    writer_.store(true, std::memory_order_seq_cst);
+    for (int spin = 0; readers_.Sum(std::memory_order_seq_cst) != 0; ++spin) {
+      if (spin < SPIN_LIMIT) {
+        CpuRelax();
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  /**
+   * Release a write latch.
+   */
+  void WUnlock() {
+    writer_.store(false, std::memory_order_release);
+    latch_.WUnlock();
+  }
+
+  /**
+   * Acquire a read latch.
+   */
+  void RLock() {
+    readers_.Add(1, std::memory_order_seq_cst);
+    if (!writer_.load(std::memory_order_seq_cst)) {
+      return;
+    }
+    readers_.Add(-1, std::memory_order_release);
+    latch_.RLock();
+    // the next writer's drain is ordered after our RUnlock below
+    readers_.Add(1, std::memory_order_relaxed);
+    latch_.RUnlock();
+  }
+
+  /**
+   * Release a read latch.
+   */
+  void RUnlock() { readers_.Add(-1, std::memory_order_release); }
+
+ private:
+  Latch latch_;
+  std::atomic<bool> writer_{false};
+  ShardedCounter readers_;
+};
+
+}  // namespace bustub
@@ -0,0 +1,103 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// spin_wait.h
+//
+// Waiting policies shared by the latches and queue locks, and an adaptive
+// spinner for spin-then-block waiting.
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+#include "futex.h"
+
+namespace bustub {
+
+/**
+ * How a waiter waits. Not every lock supports every policy.
+ */
+namespace waitpolicy {
+
+/**
+ * Spin until granted. Lowest handoff latency, but burns a core per waiter
+ * and collapses when there are more waiters than cores.
+ */
+struct Spin {};
+
+/**
+ * Spin for a fixed while, then sleep until granted.
+ */
+struct SpinThenPark {};
+
+/**
+ * Spin for as long as waits on this lock have recently lasted, with
+ * exponential backoff between probes, then sleep.
+ */
+struct Adaptive {};
+
+/**
+ * Sleep right away.
+ */
+struct Block {};
+
+}  // namespace waitpolicy
+
+/**
+ * Spin budget of one lock, learned from how long successful spins took.
+ *
+ * A spin that sees the lock change after n pause iterations moves the budget
+ * towards 2n, so the budget tracks the remaining hold time of the lock; a
+ * spin that runs out halves it, so long critical sections quickly stop
+ * being spun on. The budget never drops below MIN_SPINS so that a lock
+ * whose hold times shrink again gets re-probed.
+ */
+class AdaptiveSpinner {
+  static constexpr uint32_t MIN_SPINS = 32;
+  static constexpr uint32_t MAX_SPINS = 1 << 12;
+  static constexpr uint32_t INITIAL_SPINS = 512;
+  static constexpr uint32_t MAX_BACKOFF = 64;
+
+ public:
+  /**
+   * Spin until `ready()` or the budget runs out, true if ready.
+   */
+  template <typename Ready>
+  auto Spin(Ready ready) -> bool {
+    uint32_t budget = budget_.load(std::memory_order_relaxed);
+    uint32_t spins = 0;
+    uint32_t backoff = 1;
+    while (spins < budget) {
+      for (uint32_t i = 0; i < backoff; ++i) {
+        CpuRelax();
+      }
+      spins += backoff;
+      if (ready()) {
+        Adapt(budget, spins * 2);
+        return true;
+      }
+      backoff = std::min(backoff * 2, MAX_BACKOFF);
+    }
+    Adapt(budget, budget / 2);
+    return false;
+  }
+
+  auto Budget() const -> uint32_t { return budget_.load(std::memory_order_relaxed); }
+
+ private:
+  void Adapt(uint32_t budget, uint32_t target) {
+    // moving average over roughly the last 8 spins; racing updates may
+    // drop one, which only slows adaptation
+    int64_t next = budget + (static_cast<int64_t>(target) - budget) / 8;
+    budget_.store(std::clamp<int64_t>(next, MIN_SPINS, MAX_SPINS), std::memory_order_relaxed);
+  }
+
+  std::atomic<uint32_t> budget_{INITIAL_SPINS};
+};
+
+}  // namespace bustub
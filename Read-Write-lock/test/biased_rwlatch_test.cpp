@@ -0,0 +1,145 @@
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../src/biased_rwlatch.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+/**
+ * Parks `n` threads that each look up their visible readers slot for
+ * `latch`, then runs `a` and `b` on two of them that share a slot.
+ */
+template <typename Latch, typename A, typename B>
+auto RunOnSharedSlot(Latch &latch, int n, A a, B b) -> bool {
+  std::vector<std::atomic<const void *>> slots(n);
+  std::atomic<int> ready{0};
+  std::atomic<int> first{-1};
+  std::atomic<int> second{-1};
+  std::atomic<bool> chosen{false};
+  std::vector<std::thread> threads;
+  for (int i = 0; i < n; ++i) {
+    threads.emplace_back([&, i] {
+      slots[i] = &details::VisibleReaders::Table().Slot(&latch);
+      ready++;
+      while (!chosen.load()) {
+        std::this_thread::yield();
+      }
+      if (i == first.load()) {
+        a();
+      } else if (i == second.load()) {
+        b();
+      }
+    });
+  }
+  while (ready.load() < n) {
+    std::this_thread::yield();
+  }
+  for (int i = 0; i < n && first.load() < 0; ++i) {
+    for (int j = i + 1; j < n; ++j) {
+      if (slots[i].load() == slots[j].load()) {
+        first = i;
+        second = j;
+        break;
+      }
+    }
+  }
+  chosen = true;
+  for (auto &t : threads) {
+    t.join();
+  }
+  return first.load() >= 0;
+}
+
+TEST(ReaderBiasedLatchTest, SharedSlotKeepsEachReadersHold) {
+  ReaderBiasedLatch<> latch;
+  std::atomic<int> step{0};
+  std::atomic<const void *> *slot = nullptr;
+  auto wait_for = [&](int s) {
+    while (step.load() != s) {
+      std::this_thread::yield();
+    }
+  };
+
+  // 512 threads over 4096 slots all but surely have a pair in common
+  bool found = RunOnSharedSlot(
+      latch, 512,
+      [&] {
+        // fast path: publishes the latch in the shared slot
+        latch.RLock();
+        slot = &details::VisibleReaders::Table().Slot(&latch);
+        step = 1;
+        wait_for(2);
+        // the other reader has left, this one must still be visible
+        EXPECT_EQ(slot->load(), &latch);
+        latch.RUnlock();
+        step = 3;
+      },
+      [&] {
+        wait_for(1);
+        // the slot is taken, so this reader holds the underlying latch
+        latch.RLock();
+        latch.RUnlock();
+        step = 2;
+        wait_for(3);
+      });
+  ASSERT_TRUE(found);
+  EXPECT_EQ(slot->load(), nullptr);
+
+  // a leaked underlying read hold would make this hang
+  std::atomic<bool> written{false};
+  std::thread writer([&] {
+    latch.WLock();
+    written = true;
+    latch.WUnlock();
+  });
+  writer.join();
+  EXPECT_TRUE(written.load());
+}
+
+TEST(ReaderBiasedLatchTest, NestedReadsOfOneLatch) {
+  ReaderBiasedLatch<> latch;
+  latch.RLock();
+  latch.RLock();  // same slot, taken by the first hold: slow path
+  latch.RUnlock();
+  latch.RUnlock();
+  latch.WLock();
+  latch.WUnlock();
+  latch.RLock();
+  latch.RUnlock();
+}
+
+TEST(ReaderBiasedLatchTest, ReadersAndWritersAgree) {
+  ReaderBiasedLatch<> latch;
+  uint64_t a = 0;
+  uint64_t b = 0;
+  std::atomic<bool> torn{false};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < 20000; ++i) {
+        if (t == 0 && i % 16 == 0) {
+          latch.WLock();
+          a++;
+          b++;
+          latch.WUnlock();
+        } else {
+          latch.RLock();
+          if (a != b) {
+            torn = true;
+          }
+          latch.RUnlock();
+        }
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  EXPECT_FALSE(torn.load());
+  EXPECT_EQ(a, 1250);
+}
+
+}  // namespace bustub
@@ -0,0 +1,84 @@
+#include <assert.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../minilog.h"
+
+struct Spec {
+  int threads;
+  int records;
+  std::string file;
+};
+
+auto now_nanos() -> uint64_t {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// every thread logs `records` lines, timing each call on its own
+void run(const char *name, const Spec &spec) {
+  std::vector<std::vector<uint64_t>> samples(spec.threads);
+  std::vector<std::thread> threads;
+  auto start = now_nanos();
+  for (int t = 0; t < spec.threads; ++t) {
+    threads.emplace_back([&, t] {
+      auto &mine = samples[t];
+      mine.reserve(spec.records);
+      for (int i = 0; i < spec.records; ++i) {
+        auto before = now_nanos();
+        minilog::log_info("request {} from thread {} took {} us", i, t, 42.5);
+        mine.push_back(now_nanos() - before);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  auto calls = now_nanos() - start;
+  minilog::flush_log();
+  auto drained = now_nanos() - start;
+
+  std::vector<uint64_t> all;
+  for (auto &mine : samples) {
+    all.insert(all.end(), mine.begin(), mine.end());
+  }
+  std::sort(all.begin(), all.end());
+  auto pct = [&](double p) { return all[static_cast<size_t>(p / 100 * (all.size() - 1))]; };
+  std::cout << std::left << std::setw(16) << name << std::right << std::setw(8) << pct(50) << std::setw(8)
+            << pct(99) << std::setw(10) << pct(99.9) << std::setw(10) << all.back() << std::setw(12)
+            << calls / 1000000 << std::setw(12) << drained / 1000000 << std::endl;
+}
+
+int main(int argc, char **argv) {
+  assert(argc == 4 && "usage: ./async_bench <threads> <records_per_thread> <log_file>");
+  Spec spec{std::stoi(argv[1]), std::stoi(argv[2]), argv[3]};
+
+  std::cout << "--------Bench Spec--------" << std::endl;
+  std::cout << "threads: " << spec.threads << std::endl;
+  std::cout << "records per thread: " << spec.records << std::endl;
+  std::cout << "log file: " << spec.file << std::endl;
+  std::cout << "--------------------------" << std::endl;
+
+  // keep the console quiet, every record still goes to the file
+  minilog::set_log_level(minilog::LogLevel::fatal);
+  minilog::set_log_file(spec.file);
+
+  std::cout << std::left << std::setw(16) << "mode" << std::right << std::setw(8) << "p50 ns" << std::setw(8)
+            << "p99 ns" << std::setw(10) << "p99.9 ns" << std::setw(10) << "max ns" << std::setw(12)
+            << "calls ms" << std::setw(12) << "flushed ms" << std::endl;
+  run("sync", spec);
+  minilog::start_async(1 << 20, minilog::OverflowPolicy::block, false);
+  run("async eager", spec);
+  minilog::start_async(1 << 20, minilog::OverflowPolicy::block);
+  run("async deferred", spec);
+  minilog::start_async(1 << 20, minilog::OverflowPolicy::drop_and_count);
+  run("async drop", spec);
+  minilog::stop_async();
+  return 0;
+}
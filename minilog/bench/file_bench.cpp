@@ -0,0 +1,73 @@
+#include <assert.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../minilog.h"
+
+struct Spec {
+  int max_threads;
+  int lines;
+  std::string dir;
+};
+
+// `threads` threads write `lines` formatted lines each straight to the file,
+// lines per second
+auto run(minilog::FileMode mode, int threads, const Spec &spec) -> long {
+  auto path = spec.dir + "/file_bench.log";
+  std::filesystem::remove(path);
+  auto line = minilog::details::format_log_line(minilog::LogLevel::info, std::chrono::system_clock::now(),
+                                                "request 12345 from thread 3 took 42.5 us",
+                                                std::source_location::current());
+  auto start = std::chrono::steady_clock::now();
+  {
+    minilog::details::log_file file{nullptr};
+    file.open(path, mode);
+    assert(file.good());
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+      workers.emplace_back([&] {
+        for (int i = 0; i < spec.lines; ++i) {
+          file.write(line);
+        }
+      });
+    }
+    for (auto &worker : workers) {
+      worker.join();
+    }
+    file.flush();
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  assert(std::filesystem::file_size(path) == line.size() * spec.lines * threads);
+  std::filesystem::remove(path);
+  return static_cast<long>(threads * static_cast<double>(spec.lines) / elapsed.count());
+}
+
+int main(int argc, char **argv) {
+  assert(argc == 4 && "usage: ./file_bench <max_threads> <lines_per_thread> <dir>");
+  Spec spec{std::stoi(argv[1]), std::stoi(argv[2]), argv[3]};
+
+  std::cout << "--------Bench Spec--------" << std::endl;
+  std::cout << "max threads: " << spec.max_threads << std::endl;
+  std::cout << "lines per thread: " << spec.lines << std::endl;
+  std::cout << "dir: " << spec.dir << std::endl;
+  std::cout << "--------------------------" << std::endl;
+
+  std::cout << std::setw(8) << "threads" << std::setw(16) << "fstream" << std::setw(16) << "mmap"
+            << "   (lines/s)" << std::endl;
+  for (int threads = 1;; threads = std::min(threads * 2, spec.max_threads)) {
+    auto stream = run(minilog::FileMode::stream, threads, spec);
+    auto mapped = run(minilog::FileMode::mmap, threads, spec);
+    std::cout << std::setw(8) << threads << std::setw(16) << stream << std::setw(16) << mapped << std::endl;
+    if (threads == spec.max_threads) {
+      break;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,54 @@
+#include <assert.h>
+
+// trace is compiled out in this file whatever the build type
+#define MINILOG_ACTIVE_LEVEL 1
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "../minilog.h"
+
+// stands in for an argument that is costly to produce, e.g. a state dump
+std::string expensive_arg(int i) { return std::to_string(i) + std::string(64, '.'); }
+
+template <typename F>
+void run(const char *name, long calls, F log) {
+  auto start = std::chrono::steady_clock::now();
+  for (long i = 0; i < calls; ++i) {
+    log(static_cast<int>(i));
+  }
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  std::cout << std::left << std::setw(40) << name << std::right << std::setw(10) << std::fixed
+            << std::setprecision(2) << elapsed.count() / calls << " ns/call" << std::endl;
+}
+
+int main(int argc, char **argv) {
+  assert(argc == 2 && "usage: ./level_bench <calls>");
+  long calls = std::stol(argv[1]);
+
+  std::cout << "--------Bench Spec--------" << std::endl;
+  std::cout << "calls: " << calls << std::endl;
+  std::cout << "runtime level: info, no log file" << std::endl;
+  std::cout << "--------------------------" << std::endl;
+
+  minilog::set_log_level(minilog::LogLevel::info);
+  run("log_debug, filtered at runtime", calls, [](int i) { minilog::log_debug("value {} {}", i, 0.5); });
+  run("log_debug, expensive argument", calls, [](int i) { minilog::log_debug("state {}", expensive_arg(i)); });
+  run("MINILOG_DEBUG, expensive argument", calls, [](int i) { MINILOG_DEBUG("state {}", expensive_arg(i)); });
+  run("log_trace, compiled out", calls, [](int i) { minilog::log_trace("value {} {}", i, 0.5); });
+  run("MINILOG_TRACE, compiled out", calls, [](int i) { MINILOG_TRACE("state {}", expensive_arg(i)); });
+
+  // rate-limited sites past their first record: the info records pass the
+  // level check and go to memory, the console only takes errors
+  minilog::add_log_sink(std::make_shared<minilog::MemorySink>(1 << 16, minilog::LogLevel::info));
+  minilog::set_log_level(minilog::LogLevel::error);
+  run("log_every_n, suppressed", calls,
+      [&](int i) { minilog::log_every_n(minilog::LogLevel::info, calls + 1, "value {} {}", i, 0.5); });
+  run("log_every_ms, suppressed", calls,
+      [](int i) { minilog::log_every_ms(minilog::LogLevel::info, 3600000, "value {} {}", i, 0.5); });
+  run("log_rate_limited, suppressed", calls,
+      [](int i) { minilog::log_rate_limited(minilog::LogLevel::info, 1e-3, 1, "value {} {}", i, 0.5); });
+  return 0;
+}
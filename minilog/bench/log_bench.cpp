@@ -0,0 +1,275 @@
+#include <assert.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../minilog.h"
+
+struct Spec {
+  int max_threads;
+  int records;
+  int runs;
+  bool pin;
+  std::string dir;
+};
+
+auto now_nanos() -> uint64_t {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// nanosecond latencies in log2 buckets split four ways, ~19% wide at most
+class Histogram {
+public:
+  void add(uint64_t ns) {
+    buckets_[index(ns)]++;
+    count_++;
+    max_ = std::max(max_, ns);
+  }
+
+  void merge(const Histogram &other) {
+    for (size_t i = 0; i < k_buckets; ++i) {
+      buckets_[i] += other.buckets_[i];
+    }
+    count_ += other.count_;
+    max_ = std::max(max_, other.max_);
+  }
+
+  // upper bound of the bucket holding the p-th percentile
+  auto percentile(double p) const -> uint64_t {
+    auto rank = static_cast<uint64_t>(p / 100 * count_);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < k_buckets; ++i) {
+      seen += buckets_[i];
+      if (seen > rank) {
+        return std::min(upper(i), max_);
+      }
+    }
+    return max_;
+  }
+
+  auto max() const -> uint64_t { return max_; }
+
+private:
+  static constexpr size_t k_buckets = 64 * 4;
+
+  static auto index(uint64_t ns) -> size_t {
+    if (ns < 4) {
+      return ns;
+    }
+    auto log = 63 - __builtin_clzll(ns);
+    return log * 4 + ((ns >> (log - 2)) & 3);
+  }
+
+  static auto upper(size_t i) -> uint64_t {
+    if (i < 4) {
+      return i;
+    }
+    auto log = i / 4;
+    return ((uint64_t{4} | (i & 3)) << (log - 2)) + (uint64_t{1} << (log - 2)) - 1;
+  }
+
+  uint64_t buckets_[k_buckets]{};
+  uint64_t count_{0};
+  uint64_t max_{0};
+};
+
+// takes everything and writes nothing, leaves only the logger's own cost
+class NullSink : public minilog::LogSink {
+public:
+  void write(std::span<const std::string_view>) override {}
+};
+
+struct Mode {
+  const char *name;
+  bool async;
+  bool defer;
+};
+
+struct SinkCase {
+  const char *name;
+  std::function<std::shared_ptr<minilog::LogSink>(const std::string &dir)> make;
+};
+
+struct Result {
+  std::string mode;
+  std::string sink;
+  int threads;
+  std::vector<double> throughput;  // records per second, one per run
+  Histogram latency;
+  Histogram flush;
+};
+
+void pin(int cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu % std::thread::hardware_concurrency(), &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+// `threads` threads log `records` lines each, timing every call if
+// `latency` is set; wall nanoseconds until the last call returned
+auto log_records(const Spec &spec, int threads, int records, std::vector<Histogram> *latency) -> uint64_t {
+  std::vector<std::thread> workers;
+  auto start = now_nanos();
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t] {
+      if (spec.pin) {
+        pin(t);
+      }
+      for (int i = 0; i < records; ++i) {
+        if (latency == nullptr) {
+          minilog::log_info("request {} from thread {} took {} us", i, t, 42.5);
+          continue;
+        }
+        auto before = now_nanos();
+        minilog::log_info("request {} from thread {} took {} us", i, t, 42.5);
+        (*latency)[t].add(now_nanos() - before);
+      }
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  return now_nanos() - start;
+}
+
+auto run(const Spec &spec, const Mode &mode, const SinkCase &sink_case, int threads) -> Result {
+  Result result{mode.name, sink_case.name, threads, {}, {}, {}};
+  for (int r = 0; r < spec.runs; ++r) {
+    auto sink = sink_case.make(spec.dir);
+    minilog::add_log_sink(sink);
+    if (mode.async) {
+      minilog::start_async(1 << 20, minilog::OverflowPolicy::block, mode.defer);
+    }
+
+    // warmup: rings, buffers, file pages and the timestamp cache
+    log_records(spec, threads, std::max(spec.records / 10, 1), nullptr);
+    minilog::flush_log();
+
+    // throughput of untimed calls, up to the last call returning
+    auto wall = log_records(spec, threads, spec.records, nullptr);
+    minilog::flush_log();
+    result.throughput.push_back(1e9 * threads * spec.records / wall);
+
+    std::vector<Histogram> latency(threads);
+    log_records(spec, threads, spec.records, &latency);
+    for (auto &h : latency) {
+      result.latency.merge(h);
+    }
+    minilog::flush_log();
+
+    // end to end: one record until it is written out
+    for (int i = 0; i < 100; ++i) {
+      auto before = now_nanos();
+      minilog::log_info("flush probe {}", i);
+      minilog::flush_log();
+      result.flush.add(now_nanos() - before);
+    }
+
+    if (mode.async) {
+      minilog::stop_async();
+    }
+    minilog::remove_log_sink(sink);
+  }
+  return result;
+}
+
+auto median(std::vector<double> values) -> double {
+  std::sort(values.begin(), values.end());
+  return values[values.size() / 2];
+}
+
+void write_json(std::ostream &os, const Spec &spec, const std::vector<Result> &results) {
+  os << "{\n  \"spec\": {\"max_threads\": " << spec.max_threads << ", \"records_per_thread\": " << spec.records
+     << ", \"runs\": " << spec.runs << ", \"pin\": " << (spec.pin ? "true" : "false")
+     << ", \"cpus\": " << std::thread::hardware_concurrency() << "},\n  \"results\": [\n";
+  for (size_t i = 0; i < results.size(); ++i) {
+    auto &r = results[i];
+    os << "    {\"mode\": \"" << r.mode << "\", \"sink\": \"" << r.sink << "\", \"threads\": " << r.threads
+       << ", \"throughput\": {\"median\": " << static_cast<uint64_t>(median(r.throughput)) << ", \"runs\": [";
+    for (size_t j = 0; j < r.throughput.size(); ++j) {
+      os << (j == 0 ? "" : ", ") << static_cast<uint64_t>(r.throughput[j]);
+    }
+    os << "]}, \"latency_ns\": {\"p50\": " << r.latency.percentile(50) << ", \"p90\": " << r.latency.percentile(90)
+       << ", \"p99\": " << r.latency.percentile(99) << ", \"p99.9\": " << r.latency.percentile(99.9)
+       << ", \"max\": " << r.latency.max() << "}, \"flush_ns\": {\"p50\": " << r.flush.percentile(50)
+       << ", \"p99\": " << r.flush.percentile(99) << ", \"max\": " << r.flush.max() << "}}"
+       << (i + 1 == results.size() ? "\n" : ",\n");
+  }
+  os << "  ]\n}\n";
+}
+
+int main(int argc, char **argv) {
+  assert(argc == 6 && "usage: ./log_bench <max_threads> <records_per_thread> <runs> <pin_cpus 0|1> <out_dir>");
+  Spec spec{std::stoi(argv[1]), std::stoi(argv[2]), std::stoi(argv[3]), std::stoi(argv[4]) != 0, argv[5]};
+
+  std::cout << "--------Bench Spec--------" << std::endl;
+  std::cout << "max threads: " << spec.max_threads << std::endl;
+  std::cout << "records per thread: " << spec.records << std::endl;
+  std::cout << "runs: " << spec.runs << std::endl;
+  std::cout << "pin cpus: " << spec.pin << std::endl;
+  std::cout << "out dir: " << spec.dir << std::endl;
+  std::cout << "--------------------------" << std::endl;
+
+  // records only reach the sink under test
+  minilog::set_log_level(minilog::LogLevel::fatal);
+
+  Mode modes[] = {{"sync", false, false}, {"async", true, false}, {"async_deferred", true, true}};
+  SinkCase sinks[] = {
+      {"null", [](const std::string &) { return std::make_shared<NullSink>(); }},
+      {"devnull", [](const std::string &) {
+         static int devnull = ::open("/dev/null", O_WRONLY);
+         return std::make_shared<minilog::ConsoleSink>(minilog::LogLevel::trace, devnull);
+       }},
+      {"memory", [](const std::string &) { return std::make_shared<minilog::MemorySink>(4 << 20); }},
+      {"file", [](const std::string &dir) {
+         std::filesystem::remove(dir + "/log_bench.log");
+         return std::make_shared<minilog::FileSink>(dir + "/log_bench.log");
+       }},
+      {"mmap", [](const std::string &dir) {
+         std::filesystem::remove(dir + "/log_bench.mmap.log");
+         return std::make_shared<minilog::FileSink>(dir + "/log_bench.mmap.log", minilog::LogLevel::trace,
+                                                    minilog::FileMode::mmap);
+       }},
+  };
+
+  std::cout << std::left << std::setw(16) << "mode" << std::setw(10) << "sink" << std::right << std::setw(8)
+            << "threads" << std::setw(14) << "records/s" << std::setw(8) << "p50" << std::setw(8) << "p99"
+            << std::setw(10) << "p99.9" << std::setw(12) << "flush p50" << std::setw(12) << "flush p99"
+            << "   (ns)" << std::endl;
+  std::vector<Result> results;
+  for (auto &mode : modes) {
+    for (auto &sink : sinks) {
+      for (int threads = 1;; threads = std::min(threads * 2, spec.max_threads)) {
+        auto &r = results.emplace_back(run(spec, mode, sink, threads));
+        std::cout << std::left << std::setw(16) << r.mode << std::setw(10) << r.sink << std::right << std::setw(8)
+                  << r.threads << std::setw(14) << static_cast<uint64_t>(median(r.throughput)) << std::setw(8)
+                  << r.latency.percentile(50) << std::setw(8) << r.latency.percentile(99) << std::setw(10)
+                  << r.latency.percentile(99.9) << std::setw(12) << r.flush.percentile(50) << std::setw(12)
+                  << r.flush.percentile(99) << std::endl;
+        if (threads == spec.max_threads) {
+          break;
+        }
+      }
+    }
+  }
+
+  auto json = spec.dir + "/log_bench.json";
+  std::ofstream out(json);
+  write_json(out, spec, results);
+  std::cout << "results: " << json << std::endl;
+  return 0;
+}
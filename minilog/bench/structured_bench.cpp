@@ -0,0 +1,55 @@
+#include <assert.h>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "../minilog.h"
+
+// builds `lines` lines of the same record into a reused buffer, ns per line
+template <typename F>
+void run(const char *name, long lines, F build) {
+  std::string out;
+  size_t bytes = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (long i = 0; i < lines; ++i) {
+    out.clear();
+    build(out, static_cast<int>(i));
+    bytes += out.size();
+  }
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  std::cout << std::left << std::setw(24) << name << std::right << std::setw(10) << std::fixed << std::setprecision(1)
+            << elapsed.count() / lines << " ns/line" << std::setw(8) << bytes / lines << " bytes" << std::endl;
+  std::cout << "  " << out;
+}
+
+int main(int argc, char **argv) {
+  assert(argc == 2 && "usage: ./structured_bench <lines>");
+  long lines = std::stol(argv[1]);
+
+  std::cout << "--------Bench Spec--------" << std::endl;
+  std::cout << "lines: " << lines << std::endl;
+  std::cout << "fields: user (int), lat_us (double), path (string), ok (bool)" << std::endl;
+  std::cout << "--------------------------" << std::endl;
+
+  auto loc = std::source_location::current();
+  std::string path = "/api/v1/users";
+  double lat = 12.5;
+  using minilog::kv;
+
+  // the text path: fields concatenated into the message, then the line
+  run("text (std::format)", lines, [&](std::string &out, int i) {
+    auto msg = std::format("login user={} lat_us={} path={} ok={}", i, lat, path, true);
+    out = minilog::details::format_log_line(minilog::LogLevel::info, std::chrono::system_clock::now(), msg, loc);
+  });
+  for (auto format : {minilog::StructuredFormat::json, minilog::StructuredFormat::logfmt}) {
+    run(format == minilog::StructuredFormat::json ? "structured json" : "structured logfmt", lines,
+        [&](std::string &out, int i) {
+          minilog::details::append_structured_line(out, format, minilog::LogLevel::info,
+                                                   std::chrono::system_clock::now(), loc, "login", kv("user", i),
+                                                   kv("lat_us", lat), kv("path", path), kv("ok", true));
+        });
+  }
+  return 0;
+}
@@ -0,0 +1,74 @@
+#include <assert.h>
+
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../minilog.h"
+
+// how a line was formatted before the cache: a zoned_time per call
+std::string zoned_time_line(std::chrono::system_clock::time_point time, std::string_view msg,
+                            const std::source_location &loc) {
+  std::chrono::zoned_time now{std::chrono::current_zone(), time};
+  return std::format("[{}] {} {} [{}]: {}\n", now, loc.file_name(), loc.line(), "info", msg);
+}
+
+// lines per second formatted by `threads` threads for `millis`
+template <typename F>
+auto run(int threads, long millis, F format_line) -> long {
+  std::atomic<bool> stop{false};
+  std::vector<long> lines(threads);
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t] {
+      size_t bytes = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        bytes += format_line(std::chrono::system_clock::now()).size();
+        lines[t]++;
+      }
+      assert(bytes > 0);
+    });
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(millis));
+  stop.store(true);
+  long total = 0;
+  for (int t = 0; t < threads; ++t) {
+    workers[t].join();
+    total += lines[t];
+  }
+  return total * 1000 / millis;
+}
+
+int main(int argc, char **argv) {
+  assert(argc == 3 && "usage: ./timestamp_bench <max_threads> <millis_per_run>");
+  int max_threads = std::stoi(argv[1]);
+  long millis = std::stol(argv[2]);
+
+  std::cout << "--------Bench Spec--------" << std::endl;
+  std::cout << "max threads: " << max_threads << std::endl;
+  std::cout << "millis per run: " << millis << std::endl;
+  std::cout << "--------------------------" << std::endl;
+
+  auto loc = std::source_location::current();
+  auto now = std::chrono::system_clock::now();
+  std::cout << "zoned_time: " << zoned_time_line(now, "same line", loc);
+  std::cout << "cached:     " << minilog::details::format_log_line(minilog::LogLevel::info, now, "same line", loc);
+
+  std::cout << std::setw(8) << "threads" << std::setw(16) << "zoned_time" << std::setw(16) << "cached"
+            << "   (lines/s)" << std::endl;
+  for (int threads = 1;; threads = std::min(threads * 2, max_threads)) {
+    auto before = run(threads, millis, [&](auto time) { return zoned_time_line(time, "request served", loc); });
+    auto after = run(threads, millis, [&](auto time) {
+      return minilog::details::format_log_line(minilog::LogLevel::info, time, "request served", loc);
+    });
+    std::cout << std::setw(8) << threads << std::setw(16) << before << std::setw(16) << after << std::endl;
+    if (threads == max_threads) {
+      break;
+    }
+  }
+  return 0;
+}
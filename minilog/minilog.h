@@ -8,7 +8,49 @@
 #include <chrono>
 #include <fstream>
 #include <string_view>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <climits>
+#include <fcntl.h>
+#include <functional>
+#include <span>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+#ifdef MINILOG_ENABLE_GZIP
+#include <zlib.h>
+#endif
+
+// Levels below this are compiled out: 0 trace, 1 debug, 2 info, 3 warning,
+// 4 error, 5 fatal. Release builds drop trace by default.
+#ifndef MINILOG_ACTIVE_LEVEL
+#ifdef NDEBUG
+#define MINILOG_ACTIVE_LEVEL 1
+#else
+#define MINILOG_ACTIVE_LEVEL 0
+#endif
+#endif
 
 namespace minilog {
 #define FOREACH_LOG_LEVEL(f) \
@@ -25,7 +67,51 @@ enum class LogLevel: uint8_t {
 #undef _FUNCTION
 };
 
+// what an async log call does when its thread's ring buffer is full
+enum class OverflowPolicy: uint8_t {
+  block,           // wait for the writer thread to make room
+  drop,            // discard the record
+  drop_and_count,  // discard it, the writer reports how many were lost
+};
+
+// when the log file is closed and a new one started; the closed file is
+// renamed to `<file>.<utc time>.<sequence>`
+struct RotationPolicy {
+  size_t max_bytes = 0;              // rotate before the file would grow past this, 0: never
+  std::chrono::seconds interval{0};  // rotate this long after opening, 0: never
+  size_t max_files = 0;              // closed files to keep, the oldest are deleted, 0: all
+  bool compress = false;             // gzip closed files, needs MINILOG_ENABLE_GZIP
+};
+
+// how the log file is written
+enum class FileMode: uint8_t {
+  stream,  // through an fstream, one writer at a time, supports rotation
+  mmap,    // copied into a shared mapping of the file, writers do not lock
+};
+
+// line format of structured records
+enum class StructuredFormat: uint8_t {
+  json,    // {"time":"...","level":"info",...,"msg":"...","user":42}
+  logfmt,  // time="..." level=info ... msg="..." user=42
+};
+
+// one field of a structured record, made by kv() and used within the call
+template <typename T>
+struct KeyValue {
+  std::string_view key;
+  const T &value;
+};
+
+template <typename T>
+auto kv(std::string_view key, const T &value) -> KeyValue<T> {
+  return {key, value};
+}
+
 namespace details {
+// as an int, so comparing an unsigned level against 0 does not trip
+// -Wtype-limits the way the bare macro does
+inline constexpr int k_active_level = MINILOG_ACTIVE_LEVEL;
+
 template <typename T>
 struct with_source_location {
 private:
@@ -64,12 +150,497 @@ inline LogLevel g_max_level = []() -> LogLevel {
   return LogLevel::info;
 }();
 
-inline std::fstream g_log_file = []() -> std::fstream {
-  if (auto file_path = std::getenv("MINILOG_FILE")) {
-    return std::fstream(file_path, std::ios::app);
+// compresses and prunes closed log files on its own thread, so rotation
+// costs the writing thread only a rename and an open
+class segment_worker {
+public:
+  segment_worker() : thread_([this] { run(); }) {}
+
+  ~segment_worker() {
+    {
+      std::lock_guard lk{mutex_};
+      stop_ = true;
+    }
+    cond_.notify_one();
+    thread_.join();
+  }
+
+  segment_worker(const segment_worker &) = delete;
+  segment_worker &operator=(const segment_worker &) = delete;
+
+  void submit(std::string segment, std::string base, const RotationPolicy &policy) {
+    {
+      std::lock_guard lk{mutex_};
+      jobs_.push_back({std::move(segment), std::move(base), policy.compress, policy.max_files});
+    }
+    cond_.notify_one();
+  }
+
+private:
+  struct job {
+    std::string segment;
+    std::string base;
+    bool compress;
+    size_t max_files;
+  };
+
+  void run() {
+    std::unique_lock lk{mutex_};
+    while (true) {
+      cond_.wait(lk, [&] { return stop_ || !jobs_.empty(); });
+      if (jobs_.empty()) {
+        return;
+      }
+      auto next = std::move(jobs_.front());
+      jobs_.pop_front();
+      lk.unlock();
+      if (next.compress) {
+        compress(next.segment);
+      }
+      if (next.max_files != 0) {
+        prune(next.base, next.max_files);
+      }
+      lk.lock();
+    }
+  }
+
+  static void compress([[maybe_unused]] const std::string &path) {
+#ifdef MINILOG_ENABLE_GZIP
+    std::ifstream in(path, std::ios::binary);
+    auto out = gzopen((path + ".gz").c_str(), "wb");
+    if (!in || out == nullptr) {
+      return;
+    }
+    char buf[1 << 16];
+    while (in.read(buf, sizeof(buf)) || in.gcount() > 0) {
+      gzwrite(out, buf, static_cast<unsigned>(in.gcount()));
+    }
+    if (gzclose(out) == Z_OK) {
+      std::error_code ec;
+      std::filesystem::remove(path, ec);
+    }
+#endif
+  }
+
+  // whether `suffix` is what rotation appends to the base name,
+  // `YYYYmmdd-HHMMSS.NNNNNN` with at least six sequence digits
+  static bool is_segment_suffix(std::string_view suffix) {
+    auto digits = [&](size_t n) {
+      for (size_t i = 0; i < n; ++i) {
+        if (i >= suffix.size() || suffix[i] < '0' || suffix[i] > '9') {
+          return false;
+        }
+      }
+      suffix.remove_prefix(n);
+      return true;
+    };
+    auto skip = [&](char c) {
+      if (suffix.empty() || suffix.front() != c) {
+        return false;
+      }
+      suffix.remove_prefix(1);
+      return true;
+    };
+    return digits(8) && skip('-') && digits(6) && skip('.') && digits(6) &&
+           suffix.find_first_not_of("0123456789") == std::string_view::npos;
+  }
+
+  // delete all but the newest `keep` closed files of `base`; their names
+  // sort by age, a compressed one counts once, other files sharing the
+  // prefix are left alone
+  static void prune(const std::string &base, size_t keep) {
+    namespace fs = std::filesystem;
+    auto dir = fs::path(base).parent_path();
+    auto prefix = fs::path(base).filename().string() + ".";
+    std::vector<std::string> segments;
+    std::error_code ec;
+    for (auto &entry : fs::directory_iterator(dir.empty() ? "." : dir, ec)) {
+      auto name = entry.path().filename().string();
+      if (name.ends_with(".gz")) {
+        name.resize(name.size() - 3);
+      }
+      if (name.starts_with(prefix) && is_segment_suffix(std::string_view(name).substr(prefix.size()))) {
+        segments.push_back(std::move(name));
+      }
+    }
+    std::sort(segments.begin(), segments.end());
+    segments.erase(std::unique(segments.begin(), segments.end()), segments.end());
+    for (size_t i = 0; i + keep < segments.size(); ++i) {
+      fs::remove(dir / segments[i], ec);
+      fs::remove(dir / (segments[i] + ".gz"), ec);
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::deque<job> jobs_;
+  bool stop_{false};
+  std::thread thread_;
+};
+
+// A log file written through shared mappings. A writer reserves its bytes
+// with one fetch_add on the tail and copies them straight into the mapping;
+// the file is grown and mapped k_chunk bytes at a time, and whichever writer
+// completes a chunk unmaps it. Copied lines are in the page cache, so they
+// survive a crash of the process. Until the file is closed it ends in zero
+// bytes, which are cut off then, or skipped when reopening after a crash.
+class mmap_file {
+public:
+  static constexpr size_t k_chunk = 16 << 20;
+  // chunks mapped at once, a writer may lag this far behind the tail
+  static constexpr size_t k_slots = 16;
+
+  explicit mmap_file(const std::string &path) : fd_(::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644)) {
+    if (fd_ >= 0) {
+      start_ = data_end();
+      tail_.store(start_, std::memory_order_relaxed);
+    }
+  }
+
+  ~mmap_file() {
+    if (fd_ < 0) {
+      return;
+    }
+    for (auto &slot : slots_) {
+      if (slot.index.load(std::memory_order_relaxed) != k_unmapped && slot.base != nullptr) {
+        ::munmap(slot.base, k_chunk);
+      }
+    }
+    if (::ftruncate(fd_, static_cast<off_t>(tail_.load(std::memory_order_relaxed))) != 0) {
+      // the zero tail stays and is skipped on the next open
+    }
+    ::close(fd_);
+  }
+
+  mmap_file(const mmap_file &) = delete;
+  mmap_file &operator=(const mmap_file &) = delete;
+
+  bool good() const {
+    return fd_ >= 0;
   }
-  return std::fstream{};
-}();
+
+  void write(std::string_view data) {
+    write(std::span{&data, 1});
+  }
+
+  // lines from several places, placed back to back with one reservation
+  void write(std::span<const std::string_view> lines) {
+    size_t size = 0;
+    for (auto line : lines) {
+      size += line.size();
+    }
+    auto offset = tail_.fetch_add(size, std::memory_order_relaxed);
+    for (auto line : lines) {
+      copy(offset, line);
+      offset += line.size();
+    }
+  }
+
+private:
+  static constexpr uint64_t k_unmapped = ~uint64_t{0};
+
+  struct alignas(64) slot {
+    std::atomic<uint64_t> index{k_unmapped};
+    char *base{nullptr};          // nullptr: the chunk could not be mapped, written with pwrite
+    std::atomic<size_t> done{0};  // bytes of the chunk written
+  };
+
+  void copy(uint64_t offset, std::string_view data) {
+    while (!data.empty()) {
+      auto index = offset / k_chunk;
+      auto n = std::min(data.size(), k_chunk - offset % k_chunk);
+      auto slot = map(index);
+      if (slot->base != nullptr) {
+        std::memcpy(slot->base + offset % k_chunk, data.data(), n);
+      } else if (::pwrite(fd_, data.data(), n, static_cast<off_t>(offset)) < 0) {
+        // lost, but still counted so the slot is freed
+      }
+      if (slot->done.fetch_add(n, std::memory_order_acq_rel) + n == k_chunk) {
+        if (slot->base != nullptr) {
+          ::munmap(slot->base, k_chunk);
+        }
+        slot->index.store(k_unmapped, std::memory_order_release);
+      }
+      data.remove_prefix(n);
+      offset += n;
+    }
+  }
+
+  // the slot of chunk `index`, mapping it first if needed; a chunk the file
+  // cannot be grown or mapped for gets a slot without a mapping
+  slot *map(uint64_t index) {
+    auto &s = slots_[index % k_slots];
+    if (s.index.load(std::memory_order_acquire) == index) {
+      return &s;
+    }
+    std::unique_lock lk{mutex_};
+    while (true) {
+      auto mapped = s.index.load(std::memory_order_acquire);
+      if (mapped == index) {
+        return &s;
+      }
+      if (mapped == k_unmapped) {
+        break;
+      }
+      // a writer k_slots chunks behind is still copying
+      lk.unlock();
+      std::this_thread::yield();
+      lk.lock();
+    }
+    auto offset = static_cast<off_t>(index * k_chunk);
+    // allocate the blocks now, a full disk fails here and not with a
+    // SIGBUS on a store into the mapping
+    void *base = MAP_FAILED;
+    if (::posix_fallocate(fd_, offset, k_chunk) == 0) {
+      base = ::mmap(nullptr, k_chunk, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, offset);
+    }
+    s.base = base == MAP_FAILED ? nullptr : static_cast<char *>(base);
+    // bytes before the starting tail belong to an earlier run
+    s.done.store(index == start_ / k_chunk ? start_ % k_chunk : 0, std::memory_order_relaxed);
+    s.index.store(index, std::memory_order_release);
+    return &s;
+  }
+
+  // size of the file without the zero bytes a crashed run left at its end
+  uint64_t data_end() const {
+    struct stat st{};
+    if (::fstat(fd_, &st) != 0) {
+      return 0;
+    }
+    auto end = static_cast<uint64_t>(st.st_size);
+    char buf[1 << 16];
+    while (end > 0) {
+      auto n = std::min<uint64_t>(end, sizeof(buf));
+      if (::pread(fd_, buf, n, static_cast<off_t>(end - n)) != static_cast<ssize_t>(n)) {
+        break;
+      }
+      for (auto i = n; i > 0; --i) {
+        if (buf[i - 1] != '\0') {
+          return end - n + i;
+        }
+      }
+      end -= n;
+    }
+    return end;
+  }
+
+  int fd_;
+  uint64_t start_{0};
+  alignas(64) std::atomic<uint64_t> tail_{0};
+  std::mutex mutex_;
+  slot slots_[k_slots];
+};
+
+// The log file. Stream writes are serialized by a mutex, and rotation
+// happens on whichever thread writes: the writer thread in async mode, the
+// logging thread otherwise. Mapped writes take no lock and do not rotate.
+class log_file {
+public:
+  explicit log_file(const char *path) {
+    if (path != nullptr) {
+      open(path);
+    }
+  }
+
+  log_file(const log_file &) = delete;
+  log_file &operator=(const log_file &) = delete;
+
+  void open(const std::string &path, FileMode mode = FileMode::stream) {
+    std::lock_guard lk{mutex_};
+    path_ = path;
+    // close the old file before opening, which may be the same path: a
+    // mapping is only trimmed to its data once it is closed
+    file_.close();
+    retire_mapping();
+    if (mode == FileMode::mmap) {
+      mapped_owner_ = std::make_unique<mmap_file>(path);
+      good_.store(mapped_owner_->good(), std::memory_order_relaxed);
+      mapped_.store(mapped_owner_.get());
+      return;
+    }
+    reopen();
+  }
+
+  // cheap enough for every log call
+  bool good() const {
+    return good_.load(std::memory_order_relaxed);
+  }
+
+  // `data` is whole lines, possibly many of them
+  void write(std::string_view data) {
+    write(std::span{&data, 1});
+  }
+
+  // whole lines from several places, in order under one lock, or with one
+  // reservation in mmap mode
+  void write(std::span<const std::string_view> lines) {
+    if (write_mapped(lines)) {
+      return;
+    }
+    std::lock_guard lk{mutex_};
+    // the file may have been switched to mmap mode while we waited
+    if (write_mapped(lines)) {
+      return;
+    }
+    for (auto data : lines) {
+      write_locked(data);
+    }
+  }
+
+  void flush() {
+    std::lock_guard lk{mutex_};
+    file_.flush();
+  }
+
+  void set_rotation(const RotationPolicy &policy) {
+    std::lock_guard lk{mutex_};
+    policy_ = policy;
+    rotate_at_ = std::chrono::system_clock::now() + policy_.interval;
+    if (!worker_ && (policy_.compress || policy_.max_files != 0)) {
+      worker_ = std::make_unique<segment_worker>();
+    }
+  }
+
+private:
+  // Write through the mapping, false if there is none. A writer counts
+  // itself in under the current generation, so retire_mapping can wait for
+  // exactly the writers that may still hold the old mapping.
+  bool write_mapped(std::span<const std::string_view> lines) {
+    uint64_t generation;
+    while (true) {
+      generation = generation_.load();
+      writers_[generation & 1].fetch_add(1);
+      if (generation_.load() == generation) {
+        break;
+      }
+      writers_[generation & 1].fetch_sub(1);
+    }
+    auto mapped = mapped_.load();
+    if (mapped != nullptr) {
+      mapped->write(lines);
+    }
+    writers_[generation & 1].fetch_sub(1, std::memory_order_release);
+    return mapped != nullptr;
+  }
+
+  // unpublish the mapping, wait for writers still copying into it, then
+  // close it, which trims the file to its data; mutex_ held
+  void retire_mapping() {
+    if (!mapped_owner_) {
+      return;
+    }
+    mapped_.store(nullptr);
+    auto generation = generation_.fetch_add(1);
+    while (writers_[generation & 1].load(std::memory_order_acquire) != 0) {
+      std::this_thread::yield();
+    }
+    mapped_owner_.reset();
+  }
+
+  void write_locked(std::string_view data) {
+    if (!file_.good()) {
+      return;
+    }
+    if (policy_.interval.count() != 0 && std::chrono::system_clock::now() >= rotate_at_) {
+      rotate();
+    }
+    while (!data.empty()) {
+      auto chunk = data;
+      if (policy_.max_bytes != 0 && bytes_ + data.size() > policy_.max_bytes) {
+        // split a batch at the last line that still fits, lines are never cut
+        auto room = policy_.max_bytes > bytes_ ? policy_.max_bytes - bytes_ : 0;
+        auto end = room == 0 ? std::string_view::npos : data.rfind('\n', room - 1);
+        if (end == std::string_view::npos) {
+          if (bytes_ != 0) {
+            rotate();
+            continue;
+          }
+          // a line longer than max_bytes gets a file of its own
+          end = data.find('\n');
+        }
+        chunk = data.substr(0, end == std::string_view::npos ? end : end + 1);
+      }
+      file_.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+      bytes_ += chunk.size();
+      data.remove_prefix(chunk.size());
+    }
+  }
+
+  void reopen() {
+    file_ = std::fstream(path_, std::ios::app);
+    std::error_code ec;
+    auto size = std::filesystem::file_size(path_, ec);
+    bytes_ = ec ? 0 : size;
+    rotate_at_ = std::chrono::system_clock::now() + policy_.interval;
+    good_.store(file_.good(), std::memory_order_relaxed);
+  }
+
+  // one above the largest sequence of the segments of `base` rotated in
+  // the second `stamp`, compressed or not, 0 if there are none
+  static uint64_t next_sequence(const std::string &base, std::string_view stamp) {
+    namespace fs = std::filesystem;
+    auto dir = fs::path(base).parent_path();
+    auto prefix = std::format("{}.{}.", fs::path(base).filename().string(), stamp);
+    uint64_t next = 0;
+    std::error_code ec;
+    for (auto &entry : fs::directory_iterator(dir.empty() ? "." : dir, ec)) {
+      auto name = entry.path().filename().string();
+      if (name.ends_with(".gz")) {
+        name.resize(name.size() - 3);
+      }
+      if (!name.starts_with(prefix)) {
+        continue;
+      }
+      auto digits = std::string_view(name).substr(prefix.size());
+      uint64_t sequence;
+      auto [end, err] = std::from_chars(digits.data(), digits.data() + digits.size(), sequence);
+      if (err == std::errc{} && end == digits.data() + digits.size() && digits.size() >= 6) {
+        next = std::max(next, sequence + 1);
+      }
+    }
+    return next;
+  }
+
+  void rotate() {
+    file_.close();
+    auto now = std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now());
+    auto stamp = std::format("{:%Y%m%d-%H%M%S}", now);
+    // the sequence restarts with the process; within a second an earlier
+    // run already used, continue above its segments so names still sort by
+    // age and prune keeps the newest ones
+    if (stamp != sequence_stamp_) {
+      sequence_ = std::max(sequence_, next_sequence(path_, stamp));
+      sequence_stamp_ = stamp;
+    }
+    auto segment = std::format("{}.{}.{:06}", path_, stamp, sequence_++);
+    std::error_code ec;
+    std::filesystem::rename(path_, segment, ec);
+    reopen();
+    if (ec) {
+      // carry on in the old file rather than retry on every write
+      bytes_ = 0;
+    } else if (worker_) {
+      worker_->submit(std::move(segment), path_, policy_);
+    }
+  }
+
+  std::mutex mutex_;
+  std::string path_;
+  std::fstream file_;
+  std::atomic<bool> good_{false};
+  size_t bytes_{0};
+  RotationPolicy policy_;
+  std::chrono::system_clock::time_point rotate_at_;
+  uint64_t sequence_{0};
+  std::string sequence_stamp_;
+  std::unique_ptr<segment_worker> worker_;
+  std::unique_ptr<mmap_file> mapped_owner_;
+  std::atomic<mmap_file *> mapped_{nullptr};
+  std::atomic<uint64_t> generation_{0};
+  std::atomic<uint32_t> writers_[2]{};
+};
+
+inline log_file g_log_file{std::getenv("MINILOG_FILE")};
 
 #if defined(__linux__) || defined (__APPLE__) 
 inline constexpr char k_level_ansi_colors[(uint8_t)LogLevel::fatal + 1][8] = {
@@ -95,43 +666,1358 @@ inline constexpr char k_reset_ansi_color[1] = "";
 #define KANSK_ANSI_COLORS(x)
 #endif
 
-inline void output_log(LogLevel level, std::string msg, const std::source_location &loc) {
+// Formats timestamps exactly like zoned_time{current_zone(), t} prints
+// ("%F %T %Z"), but resolves the zone once and formats the date, time of
+// day and zone abbreviation once per second; a call within the same second
+// only writes the fraction. The per-second part sits behind a seqlock, so
+// any number of threads can read it while one of them refreshes it.
+class timestamp_cache {
+public:
+  // longest timestamp format() writes
+  static constexpr size_t k_max_size = 64;
+
+  timestamp_cache() : zone_(std::chrono::current_zone()) {}
+
+  // writes the timestamp of `time` to `out`, returns its length
+  auto format(std::chrono::system_clock::time_point time, char *out) -> size_t {
+    auto secs = std::chrono::floor<std::chrono::seconds>(time);
+    uint64_t words[k_words];
+    if (!load(secs.time_since_epoch().count(), words)) {
+      build(secs, words);
+      store(secs.time_since_epoch().count(), words);
+    }
+    auto prefix = reinterpret_cast<const char *>(words);
+    std::memcpy(out, prefix, k_date_time_len);
+    size_t n = k_date_time_len;
+    if constexpr (k_fraction_digits > 0) {
+      out[n++] = '.';
+      auto fraction = static_cast<uint64_t>((time - secs).count());
+      for (auto i = k_fraction_digits; i > 0; --i) {
+        out[n + i - 1] = static_cast<char>('0' + fraction % 10);
+        fraction /= 10;
+      }
+      n += k_fraction_digits;
+    }
+    out[n++] = ' ';
+    auto zone_len = static_cast<size_t>(prefix[k_date_time_len]);
+    std::memcpy(out + n, prefix + k_date_time_len + 1, zone_len);
+    return n + zone_len;
+  }
+
+private:
+  // "YYYY-MM-DD HH:MM:SS", then the zone abbreviation's length and bytes
+  static constexpr size_t k_words = 4;
+  static constexpr size_t k_date_time_len = 19;
+  static constexpr size_t k_max_zone_len = k_words * 8 - k_date_time_len - 1;
+  // as many digits as %T prints for the clock's precision
+  static constexpr unsigned k_fraction_digits =
+    std::chrono::hh_mm_ss<std::chrono::system_clock::duration>::fractional_width;
+
+  void build(std::chrono::sys_seconds secs, uint64_t (&words)[k_words]) const {
+    auto info = zone_->get_info(secs);
+    std::chrono::local_seconds local{(secs + info.offset).time_since_epoch()};
+    auto prefix = reinterpret_cast<char *>(words);
+    std::memset(prefix, 0, sizeof(words));
+    std::format_to_n(prefix, k_date_time_len, "{:%F %T}", local);
+    auto zone_len = std::min(info.abbrev.size(), k_max_zone_len);
+    prefix[k_date_time_len] = static_cast<char>(zone_len);
+    std::memcpy(prefix + k_date_time_len + 1, info.abbrev.data(), zone_len);
+  }
+
+  auto load(int64_t second, uint64_t (&words)[k_words]) const -> bool {
+    auto seq = seq_.load(std::memory_order_acquire);
+    if ((seq & 1) != 0 || second_.load(std::memory_order_relaxed) != second) {
+      return false;
+    }
+    for (size_t i = 0; i < k_words; ++i) {
+      words[i] = words_[i].load(std::memory_order_relaxed);
+    }
+    // keeps the loads above from sinking below the re-check
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return seq_.load(std::memory_order_relaxed) == seq;
+  }
+
+  void store(int64_t second, const uint64_t (&words)[k_words]) {
+    auto seq = seq_.load(std::memory_order_relaxed);
+    // another thread is refreshing, it will publish the same thing
+    if ((seq & 1) != 0 || !seq_.compare_exchange_strong(seq, seq + 1, std::memory_order_relaxed)) {
+      return;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    second_.store(second, std::memory_order_relaxed);
+    for (size_t i = 0; i < k_words; ++i) {
+      words_[i].store(words[i], std::memory_order_relaxed);
+    }
+    seq_.store(seq + 2, std::memory_order_release);
+  }
+
+  const std::chrono::time_zone *zone_;
+  std::atomic<uint64_t> seq_{0};
+  std::atomic<int64_t> second_{INT64_MIN};
+  std::atomic<uint64_t> words_[k_words]{};
+};
+
+inline timestamp_cache g_timestamps;
+
+inline void append_log_line(std::string &out, LogLevel level, std::chrono::system_clock::time_point time,
+                            std::string_view msg, const std::source_location &loc) {
   // output format
-  std::chrono::zoned_time now{std::chrono::current_zone(), std::chrono::system_clock::now()};
+  char now[timestamp_cache::k_max_size];
+  auto now_len = g_timestamps.format(time, now);
   auto level_name = log_level_name(level);
   level_name = K_ANSI_COLORS(k_level_ansi_colors[(uint8_t)level]) + level_name + K_ANSI_COLORS(k_reset_ansi_color);
-  msg = std::format("[{}] {} {} [{}]: {}", now, loc.file_name(), loc.line(), level_name, msg);
-  if (level >= g_max_level) {
-    std::cout << msg + '\n';
+  std::format_to(std::back_inserter(out), "[{}] {} {} [{}]: {}\n", std::string_view{now, now_len},
+                 loc.file_name(), loc.line(), level_name, msg);
+}
+
+inline std::string format_log_line(LogLevel level, std::chrono::system_clock::time_point time,
+                                   std::string_view msg, const std::source_location &loc) {
+  std::string line;
+  append_log_line(line, level, time, msg, loc);
+  return line;
+}
+
+// Write all of `lines` to `fd`, up to k_max_iov of them per writev, false
+// on an error. Sockets go through sendmsg so that a peer which went away
+// does not raise SIGPIPE.
+inline bool write_lines(int fd, std::span<const std::string_view> lines, bool socket = false) {
+  constexpr size_t k_max_iov = std::min<size_t>(IOV_MAX, 256);
+  iovec iov[k_max_iov];
+  while (!lines.empty()) {
+    auto count = std::min(lines.size(), k_max_iov);
+    for (size_t i = 0; i < count; ++i) {
+      iov[i] = {const_cast<char *>(lines[i].data()), lines[i].size()};
+    }
+    lines = lines.subspan(count);
+    auto next = iov;
+    while (count > 0) {
+      msghdr msg{};
+      msg.msg_iov = next;
+      msg.msg_iovlen = count;
+      auto written = socket ? ::sendmsg(fd, &msg, MSG_NOSIGNAL) : ::writev(fd, next, static_cast<int>(count));
+      if (written < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return false;
+      }
+      // a short write, go on from where it stopped
+      auto done = static_cast<size_t>(written);
+      while (count > 0 && done >= next->iov_len) {
+        done -= next->iov_len;
+        ++next;
+        --count;
+      }
+      if (count > 0) {
+        next->iov_base = static_cast<char *>(next->iov_base) + done;
+        next->iov_len -= done;
+      }
+    }
+  }
+  return true;
+}
+} // namespace details
+
+// a log record as sinks see it
+struct LogRecord {
+  LogLevel level;
+  std::chrono::system_clock::time_point time;
+  std::string_view message;
+  std::source_location loc;
+  bool preformatted = false;  // `message` is the whole line, e.g. a structured record
+};
+
+// appends the line for `record`, ending in '\n', to `out`
+using LogFormatter = std::function<void(std::string &out, const LogRecord &record)>;
+
+// A destination for log lines with a level and a formatter of its own.
+// Lines arrive in batches: one line per call when logging synchronously,
+// from several threads at once, and everything the writer thread drained
+// in one pass in async mode.
+class LogSink {
+public:
+  explicit LogSink(LogLevel level = LogLevel::trace) : level_(level) {}
+  virtual ~LogSink() = default;
+
+  LogSink(const LogSink &) = delete;
+  LogSink &operator=(const LogSink &) = delete;
+
+  LogLevel level() const {
+    return level_.load(std::memory_order_relaxed);
+  }
+
+  void set_level(LogLevel level);
+
+  // an empty formatter, the default, writes the console line format; set
+  // it before the sink is added
+  void set_formatter(LogFormatter formatter) {
+    formatter_ = std::move(formatter);
+  }
+
+  const LogFormatter &formatter() const {
+    return formatter_;
+  }
+
+  // false while the sink has nowhere to write, its level then counts for nothing
+  virtual bool active() const {
+    return true;
+  }
+
+  // whole lines in the order they were logged
+  virtual void write(std::span<const std::string_view> lines) = 0;
+
+  virtual void flush() {}
+
+private:
+  std::atomic<LogLevel> level_;
+  LogFormatter formatter_;
+};
+
+// stdout or another descriptor, written without buffering
+class ConsoleSink : public LogSink {
+public:
+  explicit ConsoleSink(LogLevel level = LogLevel::info, int fd = STDOUT_FILENO) : LogSink(level), fd_(fd) {}
+
+  void write(std::span<const std::string_view> lines) override {
+    details::write_lines(fd_, lines);
+  }
+
+private:
+  int fd_;
+};
+
+// a file of its own, rotated by `rotation` in stream mode
+class FileSink : public LogSink {
+public:
+  explicit FileSink(const std::string &path, LogLevel level = LogLevel::trace, FileMode mode = FileMode::stream,
+                    const RotationPolicy &rotation = {})
+    : LogSink(level), file_(nullptr) {
+    file_.set_rotation(rotation);
+    file_.open(path, mode);
+  }
+
+  bool active() const override {
+    return file_.good();
+  }
+
+  void write(std::span<const std::string_view> lines) override {
+    file_.write(lines);
+  }
+
+  void flush() override {
+    file_.flush();
+  }
+
+private:
+  details::log_file file_;
+};
+
+// Keeps the newest `capacity` bytes of lines in memory, usually at a more
+// verbose level than what is written out, to be looked at after a failure.
+class MemorySink : public LogSink {
+public:
+  explicit MemorySink(size_t capacity = 1 << 20, LogLevel level = LogLevel::trace)
+    : LogSink(level), buf_(new char[capacity]), capacity_(capacity) {}
+
+  void write(std::span<const std::string_view> lines) override {
+    std::lock_guard lk{mutex_};
+    auto written = written_.load(std::memory_order_relaxed);
+    for (auto line : lines) {
+      if (line.size() > capacity_) {
+        written += line.size() - capacity_;
+        line.remove_prefix(line.size() - capacity_);
+      }
+      auto pos = written % capacity_;
+      auto first = std::min(line.size(), capacity_ - pos);
+      std::memcpy(buf_.get() + pos, line.data(), first);
+      std::memcpy(buf_.get(), line.data() + first, line.size() - first);
+      written += line.size();
+    }
+    written_.store(written, std::memory_order_release);
+  }
+
+  // the kept lines, oldest first
+  std::string contents() const {
+    std::lock_guard lk{mutex_};
+    auto [older, newer] = parts();
+    return std::string(older) + std::string(newer);
+  }
+
+  // Write the kept lines to `fd` without locking or allocating, so it can
+  // be called from a signal handler; lines logged meanwhile may come out torn.
+  void dump(int fd) const {
+    auto [older, newer] = parts();
+    std::string_view views[] = {older, newer};
+    details::write_lines(fd, views);
+  }
+
+private:
+  // the ring as two pieces, without the line the wrap-around cut in half
+  std::pair<std::string_view, std::string_view> parts() const {
+    auto written = written_.load(std::memory_order_acquire);
+    if (written <= capacity_) {
+      return {{buf_.get(), written}, {}};
+    }
+    auto pos = written % capacity_;
+    std::string_view older{buf_.get() + pos, capacity_ - pos}, newer{buf_.get(), pos};
+    if (auto end = older.find('\n'); end != std::string_view::npos) {
+      return {older.substr(end + 1), newer};
+    }
+    auto end = newer.find('\n');
+    return {{}, end == std::string_view::npos ? std::string_view{} : newer.substr(end + 1)};
+  }
+
+  mutable std::mutex mutex_;
+  std::unique_ptr<char[]> buf_;
+  size_t capacity_;
+  std::atomic<uint64_t> written_{0};
+};
+
+// A Unix domain stream socket, e.g. a local log collector. While the peer
+// is gone lines are dropped and a reconnect is tried once a second.
+class SocketSink : public LogSink {
+public:
+  explicit SocketSink(std::string path, LogLevel level = LogLevel::trace) : LogSink(level), path_(std::move(path)) {
+    std::lock_guard lk{mutex_};
+    connect();
+  }
+
+  ~SocketSink() override {
+    if (fd_ >= 0) {
+      ::close(fd_);
+    }
+  }
+
+  void write(std::span<const std::string_view> lines) override {
+    std::lock_guard lk{mutex_};
+    if (fd_ < 0 && std::chrono::steady_clock::now() >= retry_at_) {
+      connect();
+    }
+    if (fd_ >= 0 && !details::write_lines(fd_, lines, true)) {
+      ::close(fd_);
+      fd_ = -1;
+      retry_at_ = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    }
+  }
+
+private:
+  void connect() {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (path_.size() < sizeof(addr.sun_path) && fd_ >= 0) {
+      std::memcpy(addr.sun_path, path_.data(), path_.size());
+      if (::connect(fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0) {
+        return;
+      }
+    }
+    if (fd_ >= 0) {
+      ::close(fd_);
+      fd_ = -1;
+    }
+    retry_at_ = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+  }
+
+  std::mutex mutex_;
+  std::string path_;
+  int fd_{-1};
+  std::chrono::steady_clock::time_point retry_at_;
+};
+
+namespace details {
+// the file of set_log_file and MINILOG_FILE
+class global_file_sink : public LogSink {
+public:
+  bool active() const override {
+    return g_log_file.good();
+  }
+
+  void write(std::span<const std::string_view> lines) override {
+    g_log_file.write(lines);
+  }
+
+  void flush() override {
+    g_log_file.flush();
+  }
+};
+
+// lowest level any active sink takes, or k_level_off
+inline constexpr uint8_t k_level_off = (uint8_t)LogLevel::fatal + 1;
+inline std::atomic<uint8_t> g_min_level{k_level_off};
+
+// The registered sinks. Changes swap in a new list, so a log call only
+// takes a reference to the current one.
+class sink_registry {
+public:
+  using list = std::vector<std::shared_ptr<LogSink>>;
+
+  explicit sink_registry(list sinks) : sinks_(std::make_shared<const list>(std::move(sinks))) {
+    refresh();
+  }
+
+  auto get() const -> std::shared_ptr<const list> {
+    return sinks_.load(std::memory_order_acquire);
+  }
+
+  void add(std::shared_ptr<LogSink> sink) {
+    std::lock_guard lk{mutex_};
+    auto sinks = std::make_shared<list>(*get());
+    sinks->push_back(std::move(sink));
+    sinks_.store(std::move(sinks), std::memory_order_release);
+    refresh_locked();
+  }
+
+  void remove(const std::shared_ptr<LogSink> &sink) {
+    std::lock_guard lk{mutex_};
+    auto sinks = std::make_shared<list>(*get());
+    std::erase(*sinks, sink);
+    sinks_.store(std::move(sinks), std::memory_order_release);
+    refresh_locked();
+  }
+
+  // after a level changed or a sink became active
+  void refresh() {
+    std::lock_guard lk{mutex_};
+    refresh_locked();
+  }
+
+private:
+  void refresh_locked() {
+    uint8_t min = k_level_off;
+    for (auto &sink : *get()) {
+      if (sink->active()) {
+        min = std::min(min, (uint8_t)sink->level());
+      }
+    }
+    g_min_level.store(min, std::memory_order_relaxed);
+  }
+
+  std::mutex mutex_;
+  std::atomic<std::shared_ptr<const list>> sinks_;
+};
+
+inline std::shared_ptr<LogSink> g_console_sink = std::make_shared<ConsoleSink>(g_max_level);
+inline std::shared_ptr<LogSink> g_file_sink = std::make_shared<global_file_sink>();
+inline sink_registry g_sinks{{g_console_sink, g_file_sink}};
+} // namespace details
+
+inline void LogSink::set_level(LogLevel level) {
+  level_.store(level, std::memory_order_relaxed);
+  details::g_sinks.refresh();
+}
+
+namespace details {
+
+// whether a record at `lev` would go anywhere
+inline bool should_log(LogLevel lev) {
+  return (uint8_t)lev >= g_min_level.load(std::memory_order_relaxed);
+}
+
+// One batch of lines for every sink. A record is formatted once for all
+// sinks on the default format, and once more for each sink with its own
+// formatter; then each sink gets its lines in a single write.
+class sink_batch {
+public:
+  void add(const LogRecord &record, const sink_registry::list &sinks) {
+    lines_.resize(std::max(lines_.size(), sinks.size()));
+    std::pair<size_t, size_t> shared{0, 0};
+    for (size_t i = 0; i < sinks.size(); ++i) {
+      auto &sink = *sinks[i];
+      if (record.level < sink.level() || !sink.active()) {
+        continue;
+      }
+      auto begin = text_.size();
+      if (sink.formatter()) {
+        sink.formatter()(text_, record);
+        lines_[i].emplace_back(begin, text_.size() - begin);
+        continue;
+      }
+      if (shared.second == 0) {
+        if (record.preformatted) {
+          text_ += record.message;
+        } else {
+          append_log_line(text_, record.level, record.time, record.message, record.loc);
+        }
+        shared = {begin, text_.size() - begin};
+      }
+      lines_[i].push_back(shared);
+    }
+  }
+
+  // hand the lines to `sinks`, the same list they were added with
+  void write(const sink_registry::list &sinks) {
+    for (size_t i = 0; i < std::min(sinks.size(), lines_.size()); ++i) {
+      if (lines_[i].empty()) {
+        continue;
+      }
+      views_.clear();
+      for (auto [begin, size] : lines_[i]) {
+        views_.emplace_back(text_.data() + begin, size);
+      }
+      sinks[i]->write(views_);
+      lines_[i].clear();
+    }
+    text_.clear();
+  }
+
+private:
+  std::string text_;  // every line of the batch, back to back
+  std::vector<std::vector<std::pair<size_t, size_t>>> lines_;  // offset and size in text_, per sink
+  std::vector<std::string_view> views_;
+};
+
+inline void output_log(const LogRecord &record) {
+  thread_local sink_batch batch;
+  auto sinks = g_sinks.get();
+  batch.add(record, *sinks);
+  batch.write(*sinks);
+}
+
+inline void output_log(LogLevel level, std::string_view msg, const std::source_location &loc) {
+  output_log({level, std::chrono::system_clock::now(), msg, loc});
+}
+
+// one record in a ring buffer, followed by `payload_len` bytes of payload:
+// the formatted message or line, or the encoded arguments if `format` is set
+struct record_header {
+  uint32_t size;     // of the whole record, a multiple of 8
+  bool padding;      // filler up to the end of the buffer, no fields below
+  bool preformatted; // the payload is the whole line
+  LogLevel level;
+  uint32_t payload_len;
+  std::chrono::system_clock::time_point time;
+  std::source_location loc;
+  void (*format)(std::string &out, std::string_view fmt, const std::byte *args);
+  std::string_view fmt;
+};
+
+// argument types that can be copied into a record as plain bytes and
+// formatted later on the writer thread; strings are copied by value
+template <typename T>
+inline constexpr bool is_string_arg = std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view> ||
+                                      std::is_same_v<T, const char *> || std::is_same_v<T, char *>;
+
+template <typename T>
+inline constexpr bool is_deferrable_arg = is_string_arg<T> || std::is_arithmetic_v<T> ||
+                                          std::is_pointer_v<T> || std::is_same_v<T, std::nullptr_t>;
+
+// what an argument is stored as: strings as their characters, the rest as is
+template <typename T>
+auto to_stored_arg(const T &arg) {
+  if constexpr (is_string_arg<std::decay_t<T>>) {
+    return std::string_view{arg};
+  } else {
+    return std::decay_t<T>{arg};
+  }
+}
+
+template <typename T>
+struct arg_codec {
+  static auto size(const T &) -> size_t { return sizeof(T); }
+  static auto encode(std::byte *out, const T &v) -> std::byte * {
+    std::memcpy(out, &v, sizeof(T));
+    return out + sizeof(T);
+  }
+  static auto decode(const std::byte *&in) -> T {
+    T v;
+    std::memcpy(&v, in, sizeof(T));
+    in += sizeof(T);
+    return v;
+  }
+};
+
+template <>
+struct arg_codec<std::string_view> {
+  static auto size(std::string_view v) -> size_t { return sizeof(uint32_t) + v.size(); }
+  static auto encode(std::byte *out, std::string_view v) -> std::byte * {
+    auto len = static_cast<uint32_t>(v.size());
+    std::memcpy(out, &len, sizeof(len));
+    std::memcpy(out + sizeof(len), v.data(), len);
+    return out + sizeof(len) + len;
+  }
+  // points into the record, valid while the writer holds it
+  static auto decode(const std::byte *&in) -> std::string_view {
+    uint32_t len;
+    std::memcpy(&len, in, sizeof(len));
+    auto v = std::string_view{reinterpret_cast<const char *>(in + sizeof(len)), len};
+    in += sizeof(len) + len;
+    return v;
+  }
+};
+
+// writer side of a deferred record: decode the arguments, then format
+template <typename... Ts>
+void format_stored_args(std::string &out, std::string_view fmt, [[maybe_unused]] const std::byte *in) {
+  // braced initialization decodes left to right
+  std::tuple<Ts...> values{arg_codec<Ts>::decode(in)...};
+  std::apply([&](const Ts &...v) { std::vformat_to(std::back_inserter(out), fmt, std::make_format_args(v...)); },
+             values);
+}
+
+// single-producer single-consumer byte ring. Records never wrap: one that
+// does not fit before the end is preceded by a padding record. Both sides
+// cache the other's position so they only touch its cache line when the
+// cached value says the ring looks full / empty.
+class spsc_ring {
+public:
+  explicit spsc_ring(size_t capacity)
+    : mask_(capacity - 1), buf_(new (std::align_val_t{64}) std::byte[capacity]) {}
+  ~spsc_ring() { ::operator delete[](buf_, std::align_val_t{64}); }
+  spsc_ring(const spsc_ring &) = delete;
+  spsc_ring &operator=(const spsc_ring &) = delete;
+
+  auto capacity() const -> size_t { return mask_ + 1; }
+
+  // producer: room for `n` bytes (a multiple of 8), or nullptr if full
+  auto reserve(size_t n) -> std::byte * {
+    auto tail = tail_.load(std::memory_order_relaxed);
+    auto offset = tail & mask_;
+    size_t pad = offset + n > capacity() ? capacity() - offset : 0;
+    if (capacity() - (tail - cached_head_) < pad + n) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (capacity() - (tail - cached_head_) < pad + n) {
+        return nullptr;
+      }
+    }
+    if (pad != 0) {
+      auto filler = reinterpret_cast<record_header *>(buf_ + offset);
+      filler->size = static_cast<uint32_t>(pad);
+      filler->padding = true;
+      offset = 0;
+    }
+    pending_ = pad + n;
+    return buf_ + offset;
+  }
+
+  // producer: publish what the last reserve returned
+  void commit() {
+    tail_.store(tail_.load(std::memory_order_relaxed) + pending_, std::memory_order_release);
+  }
+
+  // consumer: hand every published record to `fn`, returns how many
+  template <typename F>
+  auto drain(F &&fn) -> size_t {
+    auto head = head_.load(std::memory_order_relaxed);
+    if (head == cached_tail_) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+    }
+    size_t records = 0;
+    while (head != cached_tail_) {
+      auto record = reinterpret_cast<const record_header *>(buf_ + (head & mask_));
+      auto size = record->size;
+      if (!record->padding) {
+        fn(*record);
+        ++records;
+      }
+      head += size;
+      // free the space as soon as the record is used up, a blocked
+      // producer may be waiting for it
+      head_.store(head, std::memory_order_release);
+    }
+    return records;
+  }
+
+private:
+  const size_t mask_;
+  std::byte *const buf_;
+  alignas(64) std::atomic<uint64_t> head_{0};
+  uint64_t cached_tail_{0};
+  alignas(64) std::atomic<uint64_t> tail_{0};
+  uint64_t cached_head_{0};
+  size_t pending_{0};
+};
+
+// the ring of one logging thread, kept by the writer until it is drained
+// after the thread exits
+struct producer {
+  explicit producer(size_t capacity) : ring(capacity) {}
+  spsc_ring ring;
+  std::atomic<uint64_t> dropped{0};
+  // where the first record dropped since the last report was logged, empty
+  // once the writer took it
+  std::atomic<std::source_location> dropped_at{};
+  std::atomic<bool> closed{false};
+  uint64_t reported{0};  // writer only
+  std::source_location reported_at;  // writer only
+};
+
+// background writer draining every thread's ring into the sinks
+class async_backend {
+public:
+  // ring sizes are rounded up to a power of two in this range: a record
+  // takes at most a quarter of the ring, and its length must fit 32 bits
+  static constexpr size_t k_min_ring_bytes = 4096;
+  static constexpr size_t k_max_ring_bytes = size_t{1} << 32;
+  static_assert(k_min_ring_bytes / 4 > sizeof(record_header));
+
+  async_backend(size_t ring_bytes, OverflowPolicy policy, bool defer_formatting)
+    : ring_bytes_(std::bit_ceil(std::clamp(ring_bytes, k_min_ring_bytes, k_max_ring_bytes))), policy_(policy), defer_(defer_formatting), id_(next_id()),
+      worker_([this] { run(); }) {}
+
+  ~async_backend() {
+    {
+      std::lock_guard lk{mutex_};
+      stop_ = true;
+    }
+    wake_.notify_one();
+    worker_.join();
+  }
+
+  async_backend(const async_backend &) = delete;
+  async_backend &operator=(const async_backend &) = delete;
+
+  template <typename... Args>
+  void push(LogLevel level, const std::source_location &loc, std::string_view fmt, const Args &...args) {
+    auto time = std::chrono::system_clock::now();
+    if constexpr ((is_deferrable_arg<std::decay_t<Args>> && ...)) {
+      if (defer_ && push_deferred(level, loc, time, fmt, to_stored_arg(args)...)) {
+        return;
+      }
+    }
+    push_formatted(level, loc, time, fmt, std::make_format_args(args...));
+  }
+
+  // a message formatted by the caller, or with `preformatted` a whole line,
+  // e.g. a structured record
+  void push_message(LogLevel level, const std::source_location &loc, std::chrono::system_clock::time_point time,
+                    std::string_view msg, bool preformatted) {
+    auto msg_len = std::min(msg.size(), max_payload());
+    auto size = (sizeof(record_header) + msg_len + 7) & ~size_t{7};
+
+    auto &self = local();
+    auto slot = reserve(self, size, loc);
+    if (slot == nullptr) {
+      return;
+    }
+    auto record = new (slot) record_header{static_cast<uint32_t>(size), false, preformatted, level,
+                                           static_cast<uint32_t>(msg_len), time, loc, nullptr, {}};
+    auto payload = reinterpret_cast<char *>(record + 1);
+    std::memcpy(payload, msg.data(), msg_len);
+    if (preformatted && msg_len < msg.size()) {
+      // a cut line still ends its line
+      payload[msg_len - 1] = '\n';
+    }
+    self.ring.commit();
+  }
+
+  // wait until everything logged before the call is written out
+  void flush() {
+    std::unique_lock lk{mutex_};
+    auto ticket = ++flush_requested_;
+    wake_.notify_one();
+    flushed_.wait(lk, [&] { return flush_done_ >= ticket; });
+  }
+
+private:
+  // a record may take at most a quarter of the ring
+  auto max_payload() const -> size_t { return ring_bytes_ / 4 - sizeof(record_header); }
+
+  // room for a `size` byte record in the calling thread's ring, nullptr if
+  // the overflow policy dropped it
+  auto reserve(producer &self, size_t size, const std::source_location &loc) -> std::byte * {
+    std::byte *slot;
+    bool blocked = false;
+    while ((slot = self.ring.reserve(size)) == nullptr) {
+      if (policy_ != OverflowPolicy::block) {
+        if (policy_ == OverflowPolicy::drop_and_count) {
+          std::source_location none{};
+          self.dropped_at.compare_exchange_strong(none, loc, std::memory_order_relaxed);
+          self.dropped.store(self.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+        return nullptr;
+      }
+      if (!blocked) {
+        // counted under the mutex so the writer cannot miss it between its
+        // check and its wait; only a full ring pays for the notify
+        {
+          std::lock_guard lk{mutex_};
+          ++blocked_;
+        }
+        wake_.notify_one();
+        blocked = true;
+      }
+      std::this_thread::yield();
+    }
+    return slot;
+  }
+
+  void push_formatted(LogLevel level, const std::source_location &loc, std::chrono::system_clock::time_point time,
+                      std::string_view fmt, std::format_args args) {
+    thread_local std::string msg;
+    msg.clear();
+    std::vformat_to(std::back_inserter(msg), fmt, args);
+    push_message(level, loc, time, msg, false);
+  }
+
+  // copy the arguments as bytes, the writer formats them; false if they
+  // are too long for one record
+  template <typename... Ts>
+  auto push_deferred(LogLevel level, const std::source_location &loc, std::chrono::system_clock::time_point time,
+                     std::string_view fmt, const Ts &...values) -> bool {
+    size_t payload = (arg_codec<Ts>::size(values) + ... + 0);
+    if (payload > max_payload()) {
+      return false;
+    }
+    auto size = (sizeof(record_header) + payload + 7) & ~size_t{7};
+
+    auto &self = local();
+    auto slot = reserve(self, size, loc);
+    if (slot == nullptr) {
+      return true;
+    }
+    auto record = new (slot) record_header{static_cast<uint32_t>(size), false, false, level,
+                                           static_cast<uint32_t>(payload), time, loc, &format_stored_args<Ts...>, fmt};
+    // unused when there are no arguments
+    [[maybe_unused]] auto out = reinterpret_cast<std::byte *>(record + 1);
+    ((out = arg_codec<Ts>::encode(out, values)), ...);
+    self.ring.commit();
+    return true;
   }
-  if (g_log_file.good()) {
-    g_log_file << msg + '\n';
+
+  static auto next_id() -> uint64_t {
+    static std::atomic<uint64_t> id{0};
+    return ++id;
   }
-} 
+
+  // the calling thread's ring, registered with the writer on first use
+  auto local() -> producer & {
+    struct handle {
+      std::shared_ptr<producer> p;
+      uint64_t backend{0};
+      ~handle() {
+        if (p) {
+          p->closed.store(true, std::memory_order_release);
+        }
+      }
+    };
+    thread_local handle h;
+    if (h.backend != id_) {
+      if (h.p) {
+        h.p->closed.store(true, std::memory_order_release);
+      }
+      h.p = std::make_shared<producer>(ring_bytes_);
+      h.backend = id_;
+      std::lock_guard lk{mutex_};
+      fresh_.push_back(h.p);
+    }
+    return *h.p;
+  }
+
+  void run() {
+    std::vector<std::shared_ptr<producer>> producers;
+    sink_batch batch;
+    std::string msg;
+    uint64_t blocked_seen = 0;
+    while (true) {
+      bool stop;
+      uint64_t flush_ticket;
+      {
+        std::lock_guard lk{mutex_};
+        stop = stop_;
+        flush_ticket = flush_requested_;
+        producers.insert(producers.end(), fresh_.begin(), fresh_.end());
+        fresh_.clear();
+      }
+
+      auto sinks = g_sinks.get();
+      size_t records = 0;
+      for (auto &p : producers) {
+        // read before draining, so a ring seen closed is drained for good
+        bool closed = p->closed.load(std::memory_order_acquire);
+        records += p->ring.drain([&](const record_header &r) {
+          auto payload = reinterpret_cast<const std::byte *>(&r + 1);
+          std::string_view text{reinterpret_cast<const char *>(payload), r.payload_len};
+          if (r.format != nullptr) {
+            msg.clear();
+            r.format(msg, r.fmt, payload);
+            text = msg;
+          }
+          batch.add({r.level, r.time, text, r.loc, r.preformatted}, *sinks);
+        });
+        auto dropped = p->dropped.load(std::memory_order_acquire);
+        if (dropped != p->reported) {
+          // reported at the first dropped call, or where the previous report
+          // was if that site went with it
+          auto at = p->dropped_at.exchange({}, std::memory_order_relaxed);
+          if (at.file_name()[0] != '\0') {
+            p->reported_at = at;
+          }
+          msg = std::format("minilog dropped {} records", dropped - p->reported);
+          batch.add({LogLevel::warning, std::chrono::system_clock::now(), msg, p->reported_at}, *sinks);
+          p->reported = dropped;
+        }
+        if (closed) {
+          p.reset();
+        }
+      }
+      std::erase(producers, nullptr);
+
+      // one write per sink and pass instead of one per line
+      batch.write(*sinks);
+
+      std::unique_lock lk{mutex_};
+      if (flush_ticket > flush_done_) {
+        for (auto &sink : *sinks) {
+          sink->flush();
+        }
+        flush_done_ = flush_ticket;
+        flushed_.notify_all();
+      }
+      if (records == 0) {
+        // nothing left: exit if asked to, else poll again shortly; logging
+        // threads only notify when blocked on a full ring, anything more
+        // would cost every record a syscall
+        if (stop) {
+          return;
+        }
+        wake_.wait_for(lk, std::chrono::milliseconds(1), [&] {
+          return stop_ || flush_requested_ > flush_done_ || !fresh_.empty() || blocked_ != blocked_seen;
+        });
+        blocked_seen = blocked_;
+      }
+    }
+  }
+
+  const size_t ring_bytes_;
+  const OverflowPolicy policy_;
+  const bool defer_;
+  const uint64_t id_;
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable flushed_;
+  std::vector<std::shared_ptr<producer>> fresh_;
+  bool stop_{false};
+  uint64_t flush_requested_{0};
+  uint64_t flush_done_{0};
+  // times a producer found its ring full under OverflowPolicy::block
+  uint64_t blocked_{0};
+
+  std::thread worker_;
+};
+
+inline std::atomic<async_backend *> g_async{nullptr};
+
+// owns the backend and stops it at exit, after flushing what is left
+inline struct async_holder {
+  std::unique_ptr<async_backend> backend;
+  ~async_holder() {
+    g_async.store(nullptr, std::memory_order_release);
+  }
+} g_async_holder;
+
+template <typename T>
+struct is_key_value : std::false_type {};
+
+template <typename T>
+struct is_key_value<KeyValue<T>> : std::true_type {};
+
+// index of the first character of `text` from `pos` on that a JSON string
+// escapes, or with `logfmt` also ' ' and '=', which make a logfmt value
+// quoted; checks eight bytes per step
+template <bool logfmt>
+size_t find_special(std::string_view text, size_t pos) {
+  constexpr uint64_t ones = 0x0101010101010101, highs = 0x8080808080808080;
+  auto has_zero = [](uint64_t v) { return (v - ones) & ~v & highs; };
+  auto special = [](char c) {
+    auto u = static_cast<unsigned char>(c);
+    return u < 0x20 || c == '"' || c == '\\' || (logfmt && (c == ' ' || c == '='));
+  };
+  for (; pos + 8 <= text.size(); pos += 8) {
+    uint64_t word;
+    std::memcpy(&word, text.data() + pos, 8);
+    auto hit = ((word - ones * 0x20) & ~word & highs) | has_zero(word ^ (ones * '"')) | has_zero(word ^ (ones * '\\'));
+    if constexpr (logfmt) {
+      hit |= has_zero(word ^ (ones * ' ')) | has_zero(word ^ (ones * '='));
+    }
+    if (hit != 0) {
+      break;
+    }
+  }
+  for (; pos < text.size(); ++pos) {
+    if (special(text[pos])) {
+      return pos;
+    }
+  }
+  return text.size();
+}
+
+// append `text` as a JSON string, or as a logfmt value, quoted only when needed
+inline void append_quoted(std::string &out, std::string_view text, StructuredFormat format) {
+  if (format == StructuredFormat::logfmt && !text.empty() && find_special<true>(text, 0) == text.size()) {
+    out += text;
+    return;
+  }
+  out += '"';
+  size_t plain = 0;
+  for (size_t i; (i = find_special<false>(text, plain)) < text.size(); plain = i + 1) {
+    out.append(text.data() + plain, i - plain);
+    switch (auto c = text[i]) {
+      case '"': out += "\\\""; break;
+      case '\\': out += "\\\\"; break;
+      case '\n': out += "\\n"; break;
+      case '\r': out += "\\r"; break;
+      case '\t': out += "\\t"; break;
+      default: std::format_to(std::back_inserter(out), "\\u{:04x}", static_cast<unsigned char>(c));
+    }
+  }
+  out.append(text.data() + plain, text.size() - plain);
+  out += '"';
+}
+
+inline void append_key(std::string &out, std::string_view key, StructuredFormat format) {
+  if (format == StructuredFormat::json) {
+    out += out.back() == '{' ? "" : ",";
+    append_quoted(out, key, format);
+    out += ':';
+  } else {
+    // a key with a space, '=', a quote or a control character is quoted
+    // like a value, so that it cannot split the pair
+    out += out.empty() || out.back() == '\n' ? "" : " ";
+    append_quoted(out, key, format);
+    out += '=';
+  }
+}
+
+template <typename T>
+void append_value(std::string &out, const T &value, StructuredFormat format) {
+  if constexpr (std::is_same_v<T, bool>) {
+    out += value ? "true" : "false";
+  } else if constexpr (std::is_same_v<T, char>) {
+    // a character, not its code; signed and unsigned char stay numbers
+    append_quoted(out, std::string_view(&value, 1), format);
+  } else if constexpr (std::is_arithmetic_v<T>) {
+    if constexpr (std::is_floating_point_v<T>) {
+      if (format == StructuredFormat::json && !std::isfinite(value)) {
+        out += "null";
+        return;
+      }
+    }
+    char buf[64];
+    auto result = std::to_chars(buf, buf + sizeof(buf), value);
+    out.append(buf, result.ptr);
+  } else if constexpr (std::is_convertible_v<const T &, std::string_view>) {
+    append_quoted(out, value, format);
+  } else {
+    // anything else std::format knows, as a string
+    thread_local std::string text;
+    text.clear();
+    std::format_to(std::back_inserter(text), "{}", value);
+    append_quoted(out, text, format);
+  }
+}
+
+// one structured record as a whole line, built in place in `out`
+template <typename... Ts>
+void append_structured_line(std::string &out, StructuredFormat format, LogLevel level,
+                            std::chrono::system_clock::time_point time, const std::source_location &loc,
+                            std::string_view msg, const KeyValue<Ts> &...fields) {
+  char now[timestamp_cache::k_max_size];
+  auto now_len = g_timestamps.format(time, now);
+  if (format == StructuredFormat::json) {
+    out += '{';
+  }
+  append_key(out, "time", format);
+  append_quoted(out, {now, now_len}, format);
+  append_key(out, "level", format);
+  append_quoted(out, log_level_name(level), format);
+  append_key(out, "file", format);
+  append_quoted(out, loc.file_name(), format);
+  append_key(out, "line", format);
+  append_value(out, loc.line(), format);
+  append_key(out, "msg", format);
+  append_quoted(out, msg, format);
+  ((append_key(out, fields.key, format), append_value(out, fields.value, format)), ...);
+  out += format == StructuredFormat::json ? "}\n" : "\n";
+}
+
+inline std::atomic<StructuredFormat> g_structured_format{StructuredFormat::json};
+
+template <typename... Ts>
+void structured_log(LogLevel lev, const std::source_location &loc, std::string_view msg,
+                    const KeyValue<Ts> &...fields) {
+  thread_local std::string line;
+  line.clear();
+  auto time = std::chrono::system_clock::now();
+  append_structured_line(line, g_structured_format.load(std::memory_order_relaxed), lev, time, loc, msg,
+                         fields...);
+  if (auto backend = g_async.load(std::memory_order_acquire)) {
+    backend->push_message(lev, loc, time, line, true);
+    if (lev == LogLevel::fatal) {
+      backend->flush();
+    }
+    return;
+  }
+  output_log({lev, time, line, loc, true});
+}
 
 template<typename... Args>
 void generic_log(LogLevel lev, with_source_location<std::format_string<Args...>> fmt, Args&&... args) {
   const auto &loc = fmt.location();
+  if (auto backend = g_async.load(std::memory_order_acquire)) {
+    backend->push(lev, loc, fmt.format().get(), args...);
+    if (lev == LogLevel::fatal) {
+      // the process is likely about to die, get the record out first
+      backend->flush();
+    }
+    return;
+  }
   auto msg = std::vformat(fmt.format().get(), std::make_format_args(args...));
   output_log(lev, msg, loc);
 }
+
+// State of one rate-limited call site. Checks only touch these atomics,
+// relaxed: a race between threads at most lets one record too many through
+// or counts one the wrong way.
+struct alignas(64) site_state {
+  std::atomic<uint64_t> key{0};
+  std::atomic<uint64_t> calls{0};
+  std::atomic<int64_t> next{0};  // steady clock ns: next emit, or the bucket's theoretical arrival time
+  std::atomic<uint64_t> suppressed{0};
+};
+
+// Rate-limited call sites, found by hashing the call's source location
+// into a fixed open-addressing table; a site claims its slot on first use
+// and keeps it. Sites that find no free slot are not limited.
+class site_table {
+public:
+  static constexpr size_t k_slots = 1024;
+  static constexpr size_t k_probes = 8;
+
+  auto find(const std::source_location &loc) -> site_state * {
+    auto key = hash(loc);
+    for (size_t i = 0; i < k_probes; ++i) {
+      auto &site = sites_[((key >> 1) + i) & (k_slots - 1)];
+      auto seen = site.key.load(std::memory_order_relaxed);
+      if (seen == key ||
+          (seen == 0 && (site.key.compare_exchange_strong(seen, key, std::memory_order_relaxed) || seen == key))) {
+        return &site;
+      }
+    }
+    return nullptr;
+  }
+
+private:
+  // file names are string literals, one pointer per translation unit
+  static auto hash(const std::source_location &loc) -> uint64_t {
+    auto h = reinterpret_cast<uintptr_t>(loc.file_name()) * 0x9e3779b97f4a7c15ULL;
+    h ^= (uint64_t{loc.line()} << 20 | loc.column()) * 0xc2b2ae3d27d4eb4fULL;
+    return (h ^ (h >> 29)) | 1;
+  }
+
+  site_state sites_[k_slots];
+};
+
+inline site_table g_sites;
+
+// longest interval or burst window a limit can ask for, about 36 years;
+// longer ones are clamped so deadlines stay far from overflowing
+inline constexpr int64_t k_max_limit_nanos = int64_t{1} << 60;
+
+inline int64_t steady_nanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// log unless `admit` says the site is over its limit; an emitted record
+// carries how many were suppressed since the last one
+template <typename Admit, typename... Args>
+void limited_log(LogLevel lev, Admit admit, const with_source_location<std::format_string<Args...>> &fmt,
+                 Args &&...args) {
+  auto site = g_sites.find(fmt.location());
+  if (site != nullptr && !admit(*site)) {
+    site->suppressed.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  auto suppressed = site == nullptr || site->suppressed.load(std::memory_order_relaxed) == 0
+                        ? 0
+                        : site->suppressed.exchange(0, std::memory_order_relaxed);
+  if (suppressed == 0) {
+    generic_log(lev, fmt, std::forward<Args>(args)...);
+    return;
+  }
+  auto msg = std::vformat(fmt.format().get(), std::make_format_args(args...));
+  std::format_to(std::back_inserter(msg), " [{} suppressed]", suppressed);
+  if (auto backend = g_async.load(std::memory_order_acquire)) {
+    backend->push_message(lev, fmt.location(), std::chrono::system_clock::now(), msg, false);
+    if (lev == LogLevel::fatal) {
+      backend->flush();
+    }
+    return;
+  }
+  output_log(lev, msg, fmt.location());
+}
 } // namesapce details
 
+// line format of records logged with kv() fields
+inline void set_structured_format(StructuredFormat format) {
+  details::g_structured_format.store(format, std::memory_order_relaxed);
+}
+
+// level of the console sink
 inline void set_log_level(LogLevel lev) {
-  details::g_max_level = lev;
+  details::g_console_sink->set_level(lev);
+}
+
+// append to `file_path`, see FileMode for the two ways to write it
+inline void set_log_file(const std::string &file_path, FileMode mode = FileMode::stream) {
+  details::g_log_file.open(file_path, mode);
+  details::g_sinks.refresh();
+}
+
+// rotate the log file by size and / or age, applies to the current file
+// and to later ones set with set_log_file in stream mode
+inline void set_log_rotation(const RotationPolicy &policy) {
+  details::g_log_file.set_rotation(policy);
+}
+
+// Hand log records to a background writer: each thread puts its record into
+// its own lock-free ring of `ring_bytes` (rounded up to a power of two from
+// 4 KiB to 4 GiB) and returns, the writer thread does the timestamps and
+// the output. With `defer_formatting`
+// a call whose arguments are all numbers, pointers or strings only copies
+// them as bytes and the writer runs std::format; other calls are formatted
+// on the caller. Call before other threads start logging, and do not log
+// while calling stop_async.
+inline void start_async(size_t ring_bytes = 1 << 18, OverflowPolicy policy = OverflowPolicy::block,
+                        bool defer_formatting = true) {
+  details::g_async.store(nullptr, std::memory_order_release);
+  details::g_async_holder.backend = std::make_unique<details::async_backend>(ring_bytes, policy, defer_formatting);
+  details::g_async.store(details::g_async_holder.backend.get(), std::memory_order_release);
 }
 
-inline void set_log_file(const std::string &file_path) {
-  details::g_log_file = std::fstream(file_path, std::ios::app);
+// write out everything still buffered and go back to logging synchronously
+inline void stop_async() {
+  details::g_async.store(nullptr, std::memory_order_release);
+  details::g_async_holder.backend.reset();
 }
 
+// wait until every record logged so far is written
+inline void flush_log() {
+  if (auto backend = details::g_async.load(std::memory_order_acquire)) {
+    backend->flush();
+  }
+  for (auto &sink : *details::g_sinks.get()) {
+    sink->flush();
+  }
+}
+
+// The sinks every record goes to, each filtering by its own level. There
+// are two from the start: console_sink() writes stdout at the level of
+// set_log_level, file_sink() writes the file of set_log_file at every level.
+inline void add_log_sink(std::shared_ptr<LogSink> sink) {
+  details::g_sinks.add(std::move(sink));
+}
+
+inline void remove_log_sink(const std::shared_ptr<LogSink> &sink) {
+  details::g_sinks.remove(sink);
+}
+
+inline std::shared_ptr<LogSink> console_sink() {
+  return details::g_console_sink;
+}
+
+inline std::shared_ptr<LogSink> file_sink() {
+  return details::g_file_sink;
+}
+
+// levels below MINILOG_ACTIVE_LEVEL compile to nothing, the rest check the
+// runtime level before any formatting; with kv() arguments the call logs a
+// structured record, log_info("login", kv("user", id), kv("lat_us", t))
 #define _FUNCTION(name) template<typename... Args> \
+  requires (!details::is_key_value<std::decay_t<Args>>::value && ...) \
 void log_##name(details::with_source_location<std::format_string<Args...>> fmt, Args&&... args) { \
-  generic_log(LogLevel::name, std::move(fmt), std::forward<Args...>(args...)); \
-} 
+  if constexpr ((int)LogLevel::name >= details::k_active_level) { \
+    if (details::should_log(LogLevel::name)) { \
+      generic_log(LogLevel::name, std::move(fmt), std::forward<Args>(args)...); \
+    } \
+  } \
+} \
+template<typename T, typename... Ts> \
+void log_##name(details::with_source_location<std::string_view> msg, KeyValue<T> field, KeyValue<Ts>... fields) { \
+  if constexpr ((int)LogLevel::name >= details::k_active_level) { \
+    if (details::should_log(LogLevel::name)) { \
+      details::structured_log(LogLevel::name, msg.location(), msg.format(), field, fields...); \
+    } \
+  } \
+}
 FOREACH_LOG_LEVEL(_FUNCTION)
 #undef _FUNCTION 
 
+// Rate-limited logging for hot call sites, each site limited on its own:
+// the first of every `n` calls, n == 0 logs every call like n == 1
+template<typename... Args>
+void log_every_n(LogLevel lev, uint64_t n, details::with_source_location<std::format_string<Args...>> fmt,
+                 Args&&... args) {
+  if (details::should_log(lev)) {
+    auto admit = [n = std::max<uint64_t>(n, 1)](details::site_state &site) {
+      return site.calls.fetch_add(1, std::memory_order_relaxed) % n == 0;
+    };
+    details::limited_log(lev, admit, fmt, std::forward<Args>(args)...);
+  }
+}
+
+// at most one call every `ms` milliseconds, clamped to k_max_limit_nanos
+template<typename... Args>
+void log_every_ms(LogLevel lev, uint64_t ms, details::with_source_location<std::format_string<Args...>> fmt,
+                  Args&&... args) {
+  if (details::should_log(lev)) {
+    auto interval = static_cast<int64_t>(std::min<uint64_t>(ms, details::k_max_limit_nanos / 1000000)) * 1000000;
+    auto admit = [interval](details::site_state &site) {
+      auto now = details::steady_nanos();
+      auto next = site.next.load(std::memory_order_relaxed);
+      return now >= next && site.next.compare_exchange_strong(next, now + interval, std::memory_order_relaxed);
+    };
+    details::limited_log(lev, admit, fmt, std::forward<Args>(args)...);
+  }
+}
+
+// a token bucket: `per_second` calls on average, up to `burst` at once;
+// burst 0 counts as 1, and a rate of at most one per k_max_limit_nanos
+// (including 0, negative and NaN) lets one call through and then no more
+template<typename... Args>
+void log_rate_limited(LogLevel lev, double per_second, uint32_t burst,
+                      details::with_source_location<std::format_string<Args...>> fmt, Args&&... args) {
+  if (details::should_log(lev)) {
+    constexpr auto k_max = details::k_max_limit_nanos;
+    auto interval = per_second > 1e9 / k_max ? std::max<int64_t>(static_cast<int64_t>(1e9 / per_second), 1) : k_max;
+    auto window = interval > k_max / std::max(burst, 1u) ? k_max : interval * std::max(burst, 1u);
+    auto admit = [interval, window](details::site_state &site) {
+      // the bucket as the time it would be full again (GCRA), one word
+      auto now = details::steady_nanos();
+      auto full_at = site.next.load(std::memory_order_relaxed);
+      while (true) {
+        auto next = std::max(full_at, now) + interval;
+        if (next - now > window) {
+          return false;
+        }
+        if (site.next.compare_exchange_weak(full_at, next, std::memory_order_relaxed)) {
+          return true;
+        }
+      }
+    };
+    details::limited_log(lev, admit, fmt, std::forward<Args>(args)...);
+  }
+}
+
+// Like log_*, but the arguments are not even evaluated when the level is
+// compiled out or filtered at runtime:
+//   MINILOG_DEBUG("cache state {}", dump_cache());
+#define MINILOG_LOG(name, ...) \
+  do { \
+    if constexpr ((int)::minilog::LogLevel::name >= ::minilog::details::k_active_level) { \
+      if (::minilog::details::should_log(::minilog::LogLevel::name)) { \
+        ::minilog::log_##name(__VA_ARGS__); \
+      } \
+    } \
+  } while (0)
+#define MINILOG_TRACE(...) MINILOG_LOG(trace, __VA_ARGS__)
+#define MINILOG_DEBUG(...) MINILOG_LOG(debug, __VA_ARGS__)
+#define MINILOG_INFO(...) MINILOG_LOG(info, __VA_ARGS__)
+#define MINILOG_WARNING(...) MINILOG_LOG(warning, __VA_ARGS__)
+#define MINILOG_ERROR(...) MINILOG_LOG(error, __VA_ARGS__)
+#define MINILOG_FATAL(...) MINILOG_LOG(fatal, __VA_ARGS__)
+
 }  // namesapce minidog
 
 